@@ -0,0 +1,28 @@
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "simulator.h"
+
+/* Packet checksums shared by all protocols. get_checksum() covers seqnum, */
+/* acknum, length and the length bytes of payload in use (everything sent */
+/* but the checksum field itself).                                        */
+
+#define CHECKSUM_SUM     0  /* seqnum + acknum + length + signed payload bytes */
+#define CHECKSUM_INET16  1  /* Internet 16-bit ones' complement sum (RFC 1071) */
+#define CHECKSUM_CRC32C  2  /* CRC-32C (Castagnoli), SSE4.2 crc32 when available */
+
+#ifndef CHECKSUM_ALGORITHM
+#define CHECKSUM_ALGORITHM CHECKSUM_CRC32C
+#endif
+
+int get_checksum(struct pkt *packet);
+int get_checksum_with(int algorithm, struct pkt *packet);
+
+uint16_t inet_checksum16(const void *data, size_t len);
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+int crc32c_hw_available();
+
+#endif
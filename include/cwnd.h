@@ -0,0 +1,24 @@
+#ifndef CWND_H_
+#define CWND_H_
+
+#include <stdio.h>
+
+/* Congestion window shared by the windowed senders (GBN, SR): TCP-style   */
+/* slow start, additive increase in congestion avoidance and multiplicative */
+/* decrease on loss. The window never exceeds the -w window size.          */
+
+struct cwnd_state {
+  float cwnd;       /* congestion window, in packets */
+  float ssthresh;   /* slow start threshold, in packets */
+  int max_window;   /* upper bound on cwnd (the -w window size) */
+  FILE *trace;      /* trajectory as CSV rows time,cwnd,ssthresh,event; or NULL */
+};
+
+void cwnd_init(struct cwnd_state *cw, int max_window, const char *trace_path);
+void cwnd_on_ack(struct cwnd_state *cw, int newly_acked);
+void cwnd_on_loss(struct cwnd_state *cw);
+void cwnd_on_timeout(struct cwnd_state *cw);
+int cwnd_get(struct cwnd_state *cw);
+void cwnd_close(struct cwnd_state *cw);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef EVLOG_H_
+#define EVLOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary event log: an opt-in (-e) record of every send, loss,          */
+/* corruption, arrival, delivery and timer event of a simulation. The    */
+/* file is an evlog_header followed by a ring of evlog_records, mapped   */
+/* into memory while the simulation writes it; once the ring is full the */
+/* oldest records are overwritten. Fields are in host byte order.        */
+
+#define EVLOG_MAGIC     "PA2EVLOG"
+#define EVLOG_VERSION   1
+#define EVLOG_CAPACITY  (1 << 20)   /* records in the ring (16 MiB) */
+
+/* record kinds */
+#define EVLOG_APP          0   /* msg handed to entity by layer 5; seqnum = msg number */
+#define EVLOG_SEND         1   /* packet passed to layer 3 by entity */
+#define EVLOG_LOSS         2   /* that packet was lost */
+#define EVLOG_CORRUPT      3   /* that packet was corrupted (seq/ack as sent) */
+#define EVLOG_ARRIVE       4   /* packet arrived at entity (seq/ack as received) */
+#define EVLOG_DELIVER      5   /* msg delivered to layer 5 at entity; seqnum = msg number */
+                                   /* (msgs are numbered per sending entity)                */
+#define EVLOG_TIMER_START  6
+#define EVLOG_TIMER_STOP   7
+#define EVLOG_TIMEOUT      8
+#define EVLOG_KINDS        9
+
+struct evlog_header {
+  char magic[8];           /* EVLOG_MAGIC, not NUL terminated */
+  uint32_t version;        /* EVLOG_VERSION */
+  uint32_t record_size;    /* sizeof(struct evlog_record) */
+  uint64_t capacity;       /* records the ring holds */
+  uint64_t count;          /* records written; the ring wrapped if > capacity */
+};
+
+struct evlog_record {
+  float time;              /* simulated time */
+  uint8_t kind;            /* EVLOG_* */
+  uint8_t entity;          /* 0 = A, 1 = B */
+  uint16_t reserved;
+  int32_t seqnum;
+  int32_t acknum;
+};
+
+struct evlog {
+  int fd;
+  int writable;
+  size_t mapsize;
+  struct evlog_header *header;
+  struct evlog_record *ring;
+};
+
+/* writer: create path with room for capacity records; NULL on error */
+struct evlog *evlog_create(const char *path, uint64_t capacity);
+void evlog_write(struct evlog *log, float time, int kind, int entity, int seqnum, int acknum);
+
+/* reader: map an existing log read-only; NULL on error */
+struct evlog *evlog_open(const char *path);
+uint64_t evlog_size(const struct evlog *log);    /* records still in the ring */
+const struct evlog_record *evlog_get(const struct evlog *log, uint64_t i);  /* i-th oldest */
+
+/* unmap (a written log is trimmed to the records it holds) */
+void evlog_close(struct evlog *log);
+
+#endif
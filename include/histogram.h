@@ -0,0 +1,25 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+/* Log-bucketed (HDR-style) histogram of positive values such as message */
+/* latencies: HIST_SUB linear sub-buckets per power of two, so a reported */
+/* percentile is within 1/HIST_SUB (about 6%) of the exact value.         */
+
+#define HIST_SUB      16     /* sub-buckets per power of two */
+#define HIST_MIN_EXP  -8     /* smallest bucketed value is 2^-8 */
+#define HIST_MAX_EXP  24     /* values from 2^24 up share the last bucket */
+#define HIST_BUCKETS  ((HIST_MAX_EXP - HIST_MIN_EXP) * HIST_SUB)
+
+struct histogram {
+  long counts[HIST_BUCKETS];
+  long total;          /* values recorded */
+  double sum;          /* sum of the values, for the mean */
+  float max;           /* largest value recorded */
+};
+
+void hist_init(struct histogram *h);
+void hist_record(struct histogram *h, float value);
+float hist_percentile(const struct histogram *h, double q);   /* q in [0,1] */
+float hist_mean(const struct histogram *h);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef RTO_H_
+#define RTO_H_
+
+/* Retransmission timeout estimation shared by the protocol senders.       */
+/* SRTT/RTTVAR smoothing with exponential backoff, as in TCP (RFC 6298).   */
+/* Callers apply Karn's rule: only packets that were never retransmitted   */
+/* may be fed to rto_sample(), since their ACK is unambiguous.             */
+
+#define RTO_MIN 2.0          /* a round trip takes at least 2 time units */
+#define RTO_MAX 60.0         /* usual cap on backed off timeouts (or the tuned one if larger), plus any queueing delay */
+#define RTO_MAX_BACKOFF 2    /* at most 2^2 times the estimated timeout */
+
+struct rto_estimator {
+  float srtt;       /* smoothed round trip time */
+  float rttvar;     /* round trip time variation */
+  float rto;        /* estimated timeout, before backoff */
+  int backoff;      /* number of doublings since new data was last acked */
+  int has_sample;   /* nonzero once the first RTT has been measured */
+  float min_rto;    /* floor and cap on timeouts, set by rto_init from */
+  float max_rto;    /* the sender's bounds and the queueing delay      */
+};
+
+void rto_init(struct rto_estimator *est, float initial_rto, float min_rto, float max_rto, float queue_delay);
+void rto_sample(struct rto_estimator *est, float rtt);
+void rto_backoff(struct rto_estimator *est);
+void rto_ack(struct rto_estimator *est);
+float rto_get(struct rto_estimator *est);
+
+#endif
@@ -1,13 +1,26 @@
 #ifndef SIMULATOR_H_
 #define SIMULATOR_H_
 
-#define BIDIRECTIONAL 0
+#include <stddef.h>
+#include <stdio.h>
+
+/* Largest payload of a msg or pkt in bytes. Only the first length bytes  */
+/* are in use (-z picks the msg size, up to this ceiling); raise it for   */
+/* larger msgs, e.g. make clean all PAYLOAD_MAX=1500 (or 65536 for jumbo  */
+/* frames), at the cost of copying larger msgs and pkts.                  */
+#ifndef PAYLOAD_MAX
+#define PAYLOAD_MAX 20
+#endif
+
+/* msg size when none is given: the original 20 bytes, if the build allows */
+#define MSGSIZE_DEFAULT (PAYLOAD_MAX < 20 ? PAYLOAD_MAX : 20)
 
 /* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
 /* 4 (students' code).  It contains the data (characters) to be delivered */
 /* to layer 5 via the students transport level protocol entities.         */
 struct msg {
-  char data[20];
+  int length;          /* bytes of data in use, at most PAYLOAD_MAX */
+  char data[PAYLOAD_MAX];
 };
 
 /* a packet is the data unit passed from layer 4 (students code) to layer */
@@ -17,9 +30,13 @@ struct pkt {
    int seqnum;
    int acknum;
    int checksum;
-   char payload[20];
+   int length;         /* bytes of payload in use, at most PAYLOAD_MAX */
+   char payload[PAYLOAD_MAX];
 };
 
+/* bytes a packet takes on the link: the header fields and length bytes of payload */
+#define PKT_HEADER_BYTES  offsetof(struct pkt, payload)
+
 /* Implementation framework interface */
 void A_output(struct msg message);
 void B_output(struct msg message);
@@ -28,14 +45,101 @@ void A_timerinterrupt();
 void A_init();
 
 void B_input(struct pkt packet);
+void B_timerinterrupt();
 void B_init();
 
+/* Protocol state, defined by each protocol. The simulator creates one per */
+/* simulation before A_init()/B_init() and destroys it when the run ends.  */
+struct protocol_state;
+struct protocol_state *protocol_create();
+void protocol_destroy(struct protocol_state *state);
+
 /* Simulator API */
 void starttimer(int AorB, float increment);
 void stoptimer(int AorB);
 void tolayer3(int AorB, struct pkt packet);
-void tolayer5(int AorB, char datasent[]);
+void tolayer3_burst(int AorB, const struct pkt *packets, size_t n);
+void tolayer5(int AorB, char datasent[], int length);
 int getwinsize();
+int getbidirectional();  /* nonzero if B also gets msgs from layer 5 (-b) */
+int getdupackthreshold(); /* duplicate ACKs for a fast retransmit (-D), -1 for the protocol's own */
+int getdelayedackcount(); /* in-order pkts acknowledged at once (-A), -1 for the protocol's own */
+int getpiggyback();      /* 1 to piggyback ACKs on data, 0 not to (-P), -1 for the protocol's own */
+int getcwndmode();       /* nonzero if a congestion window limits the send window (-W) */
+const char *getcwndtrace(); /* file for A's cwnd trajectory (-C), or NULL */
+float gettimeout();      /* initial retransmission timeout (-T), 0 for the protocol's own */
+float getlinkdelay(int npkts); /* time the link takes to send npkts msg sized pkts (-z, -k) */
 float get_sim_time();
 
+/* One simulation run. Each simulation owns its event list, random number */
+/* generator, statistics and protocol state, so independent simulations   */
+/* may run concurrently, one per thread.                                   */
+#define RNG_RAND     0   /* glibc random(), the srand()/rand() stream (default) */
+#define RNG_XOSHIRO  1   /* xoshiro256** */
+#define RNG_PCG      2   /* PCG32 */
+
+struct sim_config {
+  int seed;
+  int rng;             /* random number generator, an RNG_* kind (-r) */
+  int win_size;        /* window size (-w) */
+  int nsimmax;         /* number of msgs to generate, then stop (-m) */
+  float lossprob;      /* probability that a packet is dropped (-l) */
+  float corruptprob;   /* probability that a packet is corrupted (-c) */
+  float lambda;        /* average time between messages from layer 5 (-t) */
+  int trace;           /* tracing level (-v) */
+  FILE *trace_file;    /* where trace output and warnings go, stdout if NULL */
+  const char *evlog_path;  /* binary event log to write (-e), or NULL */
+  int bidirectional;   /* layer 5 hands msgs to B as well as A (-b) */
+  int msgsize;         /* bytes of data in each msg, 1 to PAYLOAD_MAX (-z) */
+  float linkrate;      /* link rate in bytes per time unit, 0 for no */
+                       /* serialization delay (-k) */
+  int dupack_threshold;  /* duplicate ACKs that trigger a fast retransmit, */
+                         /* 0 disables, -1 for the protocol's default (-D) */
+  int cwnd_mode;         /* 1 limits the send window with slow start / AIMD */
+                         /* (capped by win_size), 0 uses the full window (-W) */
+  const char *cwnd_trace_path; /* CSV of A's cwnd trajectory, NULL for none (-C) */
+  float timeout;         /* initial retransmission timeout, until the first RTT */
+                         /* is measured; 0 for the protocol's default (-T) */
+  int delayed_ack_count; /* in-order packets B acknowledges at once, 1 disables */
+                         /* delayed ACKs, -1 for the protocol's default (-A) */
+  int piggyback;         /* 1 lets data carry the ACK of the peer's data in */
+                         /* bidirectional runs, 0 sends every ACK on its own, */
+                         /* -1 for the protocol's default (-P) */
+};
+
+struct sim_report {
+  int A_application;   /* packets sent from the application layer of A */
+  int A_transport;     /* packets sent from the transport layer of A */
+  int B_transport;     /* packets received at the transport layer of B */
+  int B_application;   /* packets received at the application layer of B */
+  /* the same from B to A; the application counts stay 0 unless bidirectional */
+  int B_application_sent;  /* packets sent from the application layer of B */
+  int B_transport_sent;    /* packets sent from the transport layer of B (ACKs too) */
+  int A_transport_recv;    /* packets received at the transport layer of A */
+  int A_application_recv;  /* packets received at the application layer of A */
+  int nsim;            /* msgs generated by layer 5 */
+  float time_local;    /* simulated time at termination */
+  /* latency of delivered msgs from A_output()/B_output() to tolayer5(), in */
+  /* time units, over both directions                                      */
+  /* (percentiles from a log-bucketed histogram, within about 6%)          */
+  float latency_mean;
+  float latency_p50;
+  float latency_p99;
+  float latency_p999;
+  float latency_max;
+};
+
+/* simulate() statuses of runs that could not start (the report is not filled) */
+#define SIM_EVLOG_FAILED 1   /* the event log (-e) could not be created */
+#define SIM_RNG_FAILED   2   /* rand() does not behave as jimsrand() expects */
+#define SIM_MSGSIZE_INVALID 3 /* msgsize is outside 1 to PAYLOAD_MAX */
+
+/* run a simulation on the calling thread; returns 0, the exit code of */
+/* the delivery check that failed (52, 63 or 145), or one of the SIM_* */
+/* statuses above */
+int simulate(const struct sim_config *config, struct sim_report *report);
+
+/* RNG_* kind named by a -r argument ("rand", "xoshiro" or "pcg"), or -1 */
+int rng_kind(const char *name);
+
 #endif
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "../include/simulator.h"
+#include "../include/rto.h"
+#include "../include/checksum.h"
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
@@ -22,110 +24,189 @@
 
 using namespace std;
 
-/* TIMEOUT_TIMEUNITS is constant for a set of expirements */
+/* TIMEOUT_TIMEUNITS is the initial timeout, until the first RTT is measured, */
+/* unless -T sets another one */
 #define TIMEOUT_TIMEUNITS 15.0 // 10.0, 15.0, 20.0, 25.0
 
-/* generic structure for entity (A/B) state */
+/* packet format: data packets carry the alternating bit in seqnum; ACKs and */
+/* NAKs carry seqnum -1 and the bit they acknowledge in acknum               */
+
+/* generic structure for entity (A/B) state; each entity sends its own data */
+/* and receives the peer's */
 struct entity
 {
+	int id; // 0 for A, 1 for B (entity passed to the simulator routines)
     int seq; // sequence number -> alt bit protocol implementation (usage values: 0,1) 
     int ack; // acknowledgment number
 	bool readyReceiveLayer5; // ready to receive layer5 data
 	struct pkt lastSentPacket; // store packet state for possible retransmission
+	float lastSentTime; // time lastSentPacket was first sent
+	bool isRetransmitted; // lastSentPacket was resent (Karn's rule: no RTT sample)
+
+	// adaptive retransmission timeout
+	struct rto_estimator rto;
+	// queue to store incoming msgs from layer 5
+	queue<struct msg> messagesQueue;
 };
-struct entity entity_A; // A
-struct entity entity_B; // B
-
-// queue to store incoming msgs from layer 5
-// (only 1 queue implemented for unidirectional transfer of data from the A-side to the B-side)
-queue<struct msg> messagesQueue;
-
-/* helper method to compute checksum */
-/* INPUT: requires pointer to packet for which checksum is to be computed */
-/* OUTPUT: computed checksum */
-int get_checksum(struct pkt *packet)
-{
-    int localsum = 0;
-	int seqnum = packet->seqnum;
-	int acknum = packet->acknum;
-	int payloadsize = sizeof(packet->payload);
-
-    localsum += seqnum;
-    localsum += acknum;
-    for (int i = 0; i < payloadsize; i++) {
-		localsum += (packet->payload)[i];
-	}
-	// localsum = ~localsum; //bitswise NOT (optional logic)
-    return localsum;
+
+/* protocol state of one simulation; made by protocol_create() and owned by the simulation */
+struct protocol_state
+{
+	struct entity entity_A; // A
+	struct entity entity_B; // B
+};
+// state of the simulation running on this thread
+thread_local struct protocol_state *state = NULL;
+
+/* called by the simulator before A_init() and B_init(): fresh state for one simulation */
+/* OUTPUT: the new state, which also becomes the state of the calling thread */
+struct protocol_state *protocol_create()
+{
+	state = new protocol_state();
+	return state;
+}
+
+/* called by the simulator once the simulation is over */
+/* INPUT: state returned by protocol_create() */
+void protocol_destroy(struct protocol_state *ended)
+{
+	if (state == ended) state = NULL;
+	delete ended;
+	return;
 }
 
 /* helper method to create data packet from message received from layer5 */
 /* INPUT: message from layer5, entity which requested (A or B) */
-/* OUTPUT: pointer to created packet */
-struct pkt *create_data_packet(struct msg message, struct entity host)
-{
-    struct pkt *packet = new struct pkt;
-    packet->seqnum = host.seq;
-    packet->acknum = host.ack;
-    strcpy(packet->payload, message.data);
-    packet->checksum = get_checksum(packet);
+/* OUTPUT: created packet (by value, nothing to free) */
+struct pkt create_data_packet(struct msg message, const struct entity *host)
+{
+    struct pkt packet;
+    packet.seqnum = host->seq;
+    packet.acknum = host->ack;
+    packet.length = message.length;
+    memcpy(packet.payload, message.data, message.length); // data is not NUL-terminated
+    packet.checksum = get_checksum(&packet);
     return packet;
 }
 
 /* helper method to create ACK / NAK packets */
 /* INPUT: ack/nak number */
-/* OUTPUT: pointer to created packet */
-struct pkt *create_ack_packet(int ack_number)
+/* OUTPUT: created packet (by value, nothing to free) */
+struct pkt create_ack_packet(int ack_number)
 {
-    struct pkt *packet = new struct pkt;
-    packet->acknum = ack_number;
-    packet->checksum = get_checksum(packet);
+    struct pkt packet;
+    packet.seqnum = -1; // no data
+    packet.acknum = ack_number;
+    packet.length = 0; // no payload
+    packet.checksum = get_checksum(&packet);
     return packet;
 }
 
-/* called from layer 5, passed the data to be sent to other side */
-void A_output(struct msg message)
+/* helper method to check whether an entity receives data */
+/* (only then does it answer packets it cannot use with a NAK) */
+bool util_receives_data(const struct entity *host)
 {
-	if (entity_A.readyReceiveLayer5 != true) {
-		// if entity_A is waiting for ack, then queue/delay incoming message from layer5
-		messagesQueue.push(message);
+	return host->id == 1 || getbidirectional();
+}
+
+/* helper method for an entity to send a msg from layer5, or queue it while waiting for an ACK */
+void util_output(struct entity *host, struct msg message)
+{
+	if (host->readyReceiveLayer5 != true) {
+		// if entity is waiting for ack, then queue/delay incoming message from layer5
+		host->messagesQueue.push(message);
 		return;
 	} else {
-		// if entity_A is ready to receive message from layer5, then create packet and pass to layer3
-		struct pkt *curr_packet = create_data_packet(message, entity_A);
-		entity_A.readyReceiveLayer5 = false;
-		entity_A.lastSentPacket = *curr_packet;
-		tolayer3(0, entity_A.lastSentPacket);
-		starttimer(0, TIMEOUT_TIMEUNITS);
+		// if entity is ready to receive message from layer5, then create packet and pass to layer3
+		host->readyReceiveLayer5 = false;
+		host->lastSentPacket = create_data_packet(message, host);
+		host->lastSentTime = get_sim_time();
+		host->isRetransmitted = false;
+		tolayer3(host->id, host->lastSentPacket);
+		starttimer(host->id, rto_get(&host->rto));
 		return;
 	}
 }
 
-/* called from layer 3, when a packet arrives for layer 4 */
-void A_input(struct pkt packet)
+/* helper method for an entity to take in a packet from layer3 */
+void util_input(struct entity *host, struct pkt packet)
 {
-	if (packet.acknum == entity_A.seq && packet.checksum == get_checksum(&packet)) { // if packet is valid
-		stoptimer(0);
-		entity_A.seq = !(entity_A.seq); // toggle entity_A seq (alternating bit)
-		entity_A.readyReceiveLayer5 = true; // set entity_A ready to recieve from layer5
-		if (!messagesQueue.empty()) {
-			//if queue not empty, pop front msg and pass for processing
-			struct msg next_msg = messagesQueue.front();
-			messagesQueue.pop();
-			A_output(next_msg);
+	bool isValid = packet.checksum == get_checksum(&packet);
+	if (isValid && packet.seqnum < 0) {
+		if (packet.acknum == host->seq) { // ACK of the packet in flight
+			stoptimer(host->id);
+			if (!host->isRetransmitted) {
+				rto_sample(&host->rto, get_sim_time() - host->lastSentTime);
+			}
+			rto_ack(&host->rto);
+			host->seq = !(host->seq); // toggle seq (alternating bit)
+			host->readyReceiveLayer5 = true; // set entity ready to recieve from layer5
+			if (!host->messagesQueue.empty()) {
+				//if queue not empty, pop front msg and pass for processing
+				struct msg next_msg = host->messagesQueue.front();
+				host->messagesQueue.pop();
+				util_output(host, next_msg);
+			}
 		}
+	} else if (isValid && packet.seqnum == host->ack) { // if data packet is valid
+		tolayer5(host->id, packet.payload, packet.length); // pass payload to layer5
+		struct pkt ack_packet = create_ack_packet(host->ack); // create ack packet
+		tolayer3(host->id, ack_packet); // pass ack packet to layer3
+		host->ack = !(host->ack); //toggle ack (alternating bit)
+	} else if (util_receives_data(host)) {
+		int nak = !(host->ack); // nak is incorrect ack...
+		struct pkt nack_packet = create_ack_packet(nak); // create nak packet
+		tolayer3(host->id, nack_packet); // pass nak packet to layer3
 	}
 	return;
 }
 
+/* helper method for an entity's timer interrupt */
+void util_timerinterrupt(struct entity *host)
+{
+	// restransmit last sent packet on timer interrupt
+	host->readyReceiveLayer5 = false;
+	host->isRetransmitted = true;
+	rto_backoff(&host->rto);
+	tolayer3(host->id, host->lastSentPacket);
+	starttimer(host->id, rto_get(&host->rto));
+	return;
+}
+
+/* helper method to initialize the state of an entity to start receiving data from layer5 */
+/* INPUT: entity, its id (0 for A, 1 for B) */
+void util_init(struct entity *host, int id)
+{
+	host->id = id;
+	host->seq = 0;
+	host->ack = 0;
+	host->readyReceiveLayer5 = true;
+	// a pkt at a time, so it only ever waits behind the peer's ACK or pkt; a
+	// spurious timeout costs one extra pkt while a late one leaves the link idle,
+	// so never time out later than the tuned timeout (nor back off past it)
+	float timeout = gettimeout() > 0 ? gettimeout() : TIMEOUT_TIMEUNITS;
+	rto_init(&host->rto, timeout, RTO_MIN, timeout, getlinkdelay(1));
+	return;
+}
+
+/* called from layer 5, passed the data to be sent to other side */
+void A_output(struct msg message)
+{
+	util_output(&state->entity_A, message);
+	return;
+}
+
+/* called from layer 3, when a packet arrives for layer 4 */
+void A_input(struct pkt packet)
+{
+	util_input(&state->entity_A, packet);
+	return;
+}
+
 /* called when A's timer goes off */
 void A_timerinterrupt()
 {
-	// restransmit last sent packet on timer interrupt
-	// cout << "time" << time << "\n";
-	entity_A.readyReceiveLayer5 = false;
-	tolayer3(0, entity_A.lastSentPacket);
-	starttimer(0, TIMEOUT_TIMEUNITS);
+	util_timerinterrupt(&state->entity_A);
 	return;
 }  
 
@@ -133,28 +214,28 @@ void A_timerinterrupt()
 /* entity A routines are called. You can use it to do any initialization */
 void A_init()
 {
-	// initialiaze state of entity_A to start receiving data from layer5
-	entity_A.seq = 0;
-	entity_A.ack = 0;
-	entity_A.readyReceiveLayer5 = true;
+	util_init(&state->entity_A, 0);
 	return;
 }
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
+/* called from layer 5 at B (bidirectional runs only), passed the data to be sent to A */
+void B_output(struct msg message)
+{
+	util_output(&state->entity_B, message);
+	return;
+}
 
 /* called from layer 3, when a packet arrives for layer 4 at B*/
 void B_input(struct pkt packet)
 {
-	if (packet.seqnum == entity_B.ack && packet.checksum == get_checksum(&packet)) { // if packet is valid
-		tolayer5(1, packet.payload); // pass payload to layer5
-		struct pkt *ack_packet = create_ack_packet(entity_B.ack); // create ack packet
-		tolayer3(1, (*ack_packet)); // pass ack packet to layer3
-		entity_B.ack = !(entity_B.ack); //toggle ack (alternating bit)
-	} else {
-		int nak = !(entity_B.ack); // nak is incorrect ack...
-		struct pkt *nack_packet = create_ack_packet(nak); // create nak packet
-		tolayer3(1, (*nack_packet)); // pass nak packet to layer3
-	}
+	util_input(&state->entity_B, packet);
+	return;
+}
+
+/* called when B's timer goes off */
+void B_timerinterrupt()
+{
+	util_timerinterrupt(&state->entity_B);
 	return;
 }
 
@@ -162,9 +243,6 @@ void B_input(struct pkt packet)
 /* entity B routines are called. You can use it to do any initialization */
 void B_init()
 {
-	// initialiaze state of entity_B
-	entity_B.seq = 0; // unused as B is not transmitting app layer data to A
-	entity_B.ack = 0;
-	entity_B.readyReceiveLayer5 = true; // unused as B is not transmitting app layer data to A
+	util_init(&state->entity_B, 1);
 	return;
 }
@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "../include/checksum.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CHECKSUM_HAVE_X86 1
+#include <nmmintrin.h>
+#endif
+
+/* CRC-32C polynomial, bit reversed */
+#define CRC32C_POLY 0x82F63B78u
+
+/* slicing-by-8 tables for the portable CRC-32C, filled on first use */
+static uint32_t crc32c_table[8][256];
+
+static int crc32c_init_table()
+{
+  uint32_t crc;
+  int i, j;
+
+  for (i = 0; i < 256; i++) {
+    crc = i;
+    for (j = 0; j < 8; j++)
+      crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+    crc32c_table[0][i] = crc;
+  }
+  for (i = 0; i < 256; i++)
+    for (j = 1; j < 8; j++)
+      crc32c_table[j][i] = (crc32c_table[j-1][i] >> 8) ^ crc32c_table[0][crc32c_table[j-1][i] & 0xff];
+  return 1;
+}
+
+/* portable CRC-32C, eight bytes per step */
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+  static const int ready = crc32c_init_table(); /* once, even with concurrent simulations */
+  uint64_t word;
+
+  (void)ready;
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&word, p, 8);        /* little endian load */
+    word ^= crc;
+    crc = crc32c_table[7][word & 0xff] ^
+          crc32c_table[6][(word >> 8) & 0xff] ^
+          crc32c_table[5][(word >> 16) & 0xff] ^
+          crc32c_table[4][(word >> 24) & 0xff] ^
+          crc32c_table[3][(word >> 32) & 0xff] ^
+          crc32c_table[2][(word >> 40) & 0xff] ^
+          crc32c_table[1][(word >> 48) & 0xff] ^
+          crc32c_table[0][word >> 56];
+  }
+  for (; len > 0; p++, len--)
+    crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p) & 0xff];
+  return crc;
+}
+
+#ifdef CHECKSUM_HAVE_X86
+/* CRC-32C with the SSE4.2 crc32 instruction, eight bytes per step */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+  uint64_t word, crc64 = crc;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&word, p, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = (uint32_t)crc64;
+  for (; len > 0; p++, len--)
+    crc = _mm_crc32_u8(crc, *p);
+  return crc;
+}
+#endif
+
+/* nonzero if crc32c() runs on the SSE4.2 crc32 instruction */
+int crc32c_hw_available()
+{
+#ifdef CHECKSUM_HAVE_X86
+  static const int hw = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+
+  return hw;
+#else
+  return 0;
+#endif
+}
+
+/* extend a CRC-32C (start with crc = 0) over len bytes of data */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+
+  crc = ~crc;
+#ifdef CHECKSUM_HAVE_X86
+  if (crc32c_hw_available())
+    return ~crc32c_hw(crc, p, len);
+#endif
+  return ~crc32c_sw(crc, p, len);
+}
+
+/* add len bytes to an Internet checksum accumulator, 32-bit words at a */
+/* time; pieces of a message must start at even offsets                */
+static uint64_t inet_sum(uint64_t sum, const unsigned char *p, size_t len)
+{
+  uint32_t word;
+  uint16_t half;
+
+  for (; len >= 4; p += 4, len -= 4) {
+    memcpy(&word, p, 4);
+    sum += word;
+  }
+  if (len >= 2) {
+    memcpy(&half, p, 2);
+    sum += half;
+    p += 2;
+    len -= 2;
+  }
+  if (len > 0)
+    sum += *p;
+  return sum;
+}
+
+/* fold an Internet checksum accumulator down to 16 bits */
+static uint16_t inet_fold(uint64_t sum)
+{
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return (uint16_t)~sum;
+}
+
+/* Internet checksum of len bytes: 32-bit words are added into a 64-bit */
+/* accumulator and folded down to 16 bits at the end                    */
+uint16_t inet_checksum16(const void *data, size_t len)
+{
+  return inet_fold(inet_sum(0, (const unsigned char *)data, len));
+}
+
+/* the checksummed header fields of a packet; the length bytes of payload */
+/* in use follow it                                                      */
+struct checksum_header {
+  int seqnum;
+  int acknum;
+  int length;
+};
+
+/* checksum of packet with the given CHECKSUM_* algorithm */
+int get_checksum_with(int algorithm, struct pkt *packet)
+{
+  struct checksum_header header;
+  size_t i, len;
+  int localsum;
+
+  /* a corrupted length still checksums within the payload array */
+  len = packet->length < 0 ? 0 : packet->length > PAYLOAD_MAX ? PAYLOAD_MAX : packet->length;
+  if (algorithm == CHECKSUM_SUM) {
+    localsum = packet->seqnum + packet->acknum + packet->length;
+    for (i = 0; i < len; i++)
+      localsum += packet->payload[i];
+    return localsum;
+  }
+  header.seqnum = packet->seqnum;
+  header.acknum = packet->acknum;
+  header.length = packet->length;
+  if (algorithm == CHECKSUM_INET16)
+    return inet_fold(inet_sum(inet_sum(0, (const unsigned char *)&header, sizeof(header)),
+                              (const unsigned char *)packet->payload, len));
+  return (int)crc32c(crc32c(0, &header, sizeof(header)), packet->payload, len);
+}
+
+/* checksum of packet with the configured CHECKSUM_ALGORITHM */
+int get_checksum(struct pkt *packet)
+{
+  return get_checksum_with(CHECKSUM_ALGORITHM, packet);
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/checksum.h"
+
+/* Microbenchmark of the packet checksums: ns per packet for each         */
+/* CHECKSUM_* algorithm, and the share of single corruptions (as made by  */
+/* tolayer3: header overwritten or first payload byte replaced) it misses */
+/* usage: checksum_bench [packets]                                        */
+
+#define BENCH_DEFAULT_PACKETS 10000000
+#define BENCH_POOL 1024 // distinct packets cycled through
+#define BENCH_PAYLOAD 20 // payload bytes per packet, the default msg size
+
+static const char *algorithm_name[] = { "sum", "inet16", "crc32c" };
+
+static double now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+  static struct pkt pool[BENCH_POOL];
+  long packets = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PACKETS;
+  long i, missed, corrupted;
+  unsigned int sink;
+  double start, elapsed;
+  int algorithm, j;
+
+  if (packets <= 0) {
+    fprintf(stderr, "usage: %s [packets]\n", argv[0]);
+    return 1;
+  }
+  srand(1234);
+  for (i = 0; i < BENCH_POOL; i++) {
+    pool[i].seqnum = i;
+    pool[i].acknum = rand() % BENCH_POOL;
+    pool[i].length = BENCH_PAYLOAD;
+    for (j = 0; j < BENCH_PAYLOAD; j++)
+      pool[i].payload[j] = 'a' + rand() % 26;
+  }
+
+  printf("crc32c: %s\n", crc32c_hw_available() ? "sse4.2" : "table");
+  printf("%-8s %12s %12s\n", "algo", "ns/packet", "missed");
+  for (algorithm = CHECKSUM_SUM; algorithm <= CHECKSUM_CRC32C; algorithm++) {
+    sink = 0;
+    start = now_ns();
+    for (i = 0; i < packets; i++)
+      sink += get_checksum_with(algorithm, &pool[i % BENCH_POOL]);
+    elapsed = now_ns() - start;
+
+    missed = corrupted = 0;
+    for (i = 0; i < BENCH_POOL; i++) {
+      struct pkt bad = pool[i];
+      int good = get_checksum_with(algorithm, &pool[i]);
+      switch (i % 3) {
+        case 0: bad.seqnum = 999999; break;
+        case 1: bad.acknum = 999999; break;
+        default: bad.payload[0] = 'Z'; break;
+      }
+      if (memcmp(&bad, &pool[i], sizeof(bad)) == 0) continue; // nothing changed
+      corrupted++;
+      if (get_checksum_with(algorithm, &bad) == good) missed++;
+    }
+    printf("%-8s %12.2f %7ld/%-4ld (%u)\n", algorithm_name[algorithm],
+           elapsed / packets, missed, corrupted, sink & 0xff);
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "../include/simulator.h"
+#include "../include/cwnd.h"
+
+/* the smallest ssthresh a loss can leave behind, in packets */
+#define CWND_MIN_SSTHRESH 2.0
+
+/* append the current state to the trajectory file, if one is open */
+static void cwnd_trace(struct cwnd_state *cw, const char *event)
+{
+  if (cw->trace != NULL)
+    fprintf(cw->trace, "%f,%f,%f,%s\n", get_sim_time(), cw->cwnd, cw->ssthresh, event);
+}
+
+/* start in slow start with a window of one packet; trace_path may be NULL */
+void cwnd_init(struct cwnd_state *cw, int max_window, const char *trace_path)
+{
+  cw->cwnd = 1;
+  cw->ssthresh = max_window;
+  cw->max_window = max_window;
+  cw->trace = NULL;
+  if (trace_path != NULL) {
+    cw->trace = fopen(trace_path, "w");
+    if (cw->trace == NULL)
+      perror(trace_path);
+    else
+      fprintf(cw->trace, "time,cwnd,ssthresh,event\n");
+  }
+  cwnd_trace(cw, "init");
+}
+
+/* grow the window for newly_acked packets acknowledged for the first time: */
+/* one packet per ACK in slow start, about one packet per window afterwards */
+void cwnd_on_ack(struct cwnd_state *cw, int newly_acked)
+{
+  int i;
+
+  for (i = 0; i < newly_acked && cw->cwnd < cw->max_window; i++) {
+    if (cw->cwnd < cw->ssthresh)
+      cw->cwnd += 1;
+    else
+      cw->cwnd += 1/cw->cwnd;
+  }
+  if (cw->cwnd > cw->max_window)
+    cw->cwnd = cw->max_window;
+  if (newly_acked > 0)
+    cwnd_trace(cw, "ack");
+}
+
+/* loss detected while ACKs still flow (fast retransmit): halve the window */
+void cwnd_on_loss(struct cwnd_state *cw)
+{
+  cw->ssthresh = cw->cwnd/2;
+  if (cw->ssthresh < CWND_MIN_SSTHRESH)
+    cw->ssthresh = CWND_MIN_SSTHRESH;
+  cw->cwnd = cw->ssthresh;
+  cwnd_trace(cw, "loss");
+}
+
+/* retransmission timeout: halve ssthresh and restart from slow start */
+void cwnd_on_timeout(struct cwnd_state *cw)
+{
+  cw->ssthresh = cw->cwnd/2;
+  if (cw->ssthresh < CWND_MIN_SSTHRESH)
+    cw->ssthresh = CWND_MIN_SSTHRESH;
+  cw->cwnd = 1;
+  cwnd_trace(cw, "timeout");
+}
+
+/* usable window in whole packets, in [1, max_window] */
+int cwnd_get(struct cwnd_state *cw)
+{
+  int w = (int)cw->cwnd;
+
+  if (w < 1)
+    w = 1;
+  if (w > cw->max_window)
+    w = cw->max_window;
+  return w;
+}
+
+/* close the trajectory file, if one is open */
+void cwnd_close(struct cwnd_state *cw)
+{
+  if (cw->trace != NULL)
+    fclose(cw->trace);
+  cw->trace = NULL;
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/evlog.h"
+
+/* map size bytes of fd, or NULL */
+static struct evlog *evlog_map(int fd, size_t size, int writable)
+{
+  struct evlog *log;
+  void *base;
+
+  base = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    return NULL;
+  log = (struct evlog *)malloc(sizeof(struct evlog));
+  if (log == NULL) {
+    munmap(base, size);
+    return NULL;
+  }
+  log->fd = fd;
+  log->writable = writable;
+  log->mapsize = size;
+  log->header = (struct evlog_header *)base;
+  log->ring = (struct evlog_record *)(log->header + 1);
+  return log;
+}
+
+struct evlog *evlog_create(const char *path, uint64_t capacity)
+{
+  struct evlog *log;
+  size_t size = sizeof(struct evlog_header) + capacity * sizeof(struct evlog_record);
+  int fd;
+
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, size) != 0 || (log = evlog_map(fd, size, 1)) == NULL) {
+    perror(path);
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  memcpy(log->header->magic, EVLOG_MAGIC, sizeof(log->header->magic));
+  log->header->version = EVLOG_VERSION;
+  log->header->record_size = sizeof(struct evlog_record);
+  log->header->capacity = capacity;
+  log->header->count = 0;
+  return log;
+}
+
+void evlog_write(struct evlog *log, float time, int kind, int entity, int seqnum, int acknum)
+{
+  struct evlog_record *r = &log->ring[log->header->count % log->header->capacity];
+
+  r->time = time;
+  r->kind = kind;
+  r->entity = entity;
+  r->reserved = 0;
+  r->seqnum = seqnum;
+  r->acknum = acknum;
+  log->header->count++;
+}
+
+struct evlog *evlog_open(const char *path)
+{
+  struct evlog *log;
+  struct evlog_header *h;
+  struct stat st;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct evlog_header) ||
+      (log = evlog_map(fd, st.st_size, 0)) == NULL) {
+    perror(path);
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  h = log->header;
+  if (memcmp(h->magic, EVLOG_MAGIC, sizeof(h->magic)) != 0 || h->version != EVLOG_VERSION ||
+      h->record_size != sizeof(struct evlog_record) || h->capacity == 0 ||
+      sizeof(struct evlog_header) + evlog_size(log) * sizeof(struct evlog_record) > (size_t)st.st_size) {
+    fprintf(stderr, "%s: not an event log of this version\n", path);
+    evlog_close(log);
+    return NULL;
+  }
+  return log;
+}
+
+uint64_t evlog_size(const struct evlog *log)
+{
+  uint64_t count = log->header->count;
+
+  return count < log->header->capacity ? count : log->header->capacity;
+}
+
+const struct evlog_record *evlog_get(const struct evlog *log, uint64_t i)
+{
+  uint64_t first = log->header->count - evlog_size(log);
+
+  return &log->ring[(first + i) % log->header->capacity];
+}
+
+void evlog_close(struct evlog *log)
+{
+  size_t used = sizeof(struct evlog_header) + evlog_size(log) * sizeof(struct evlog_record);
+  int trim = log->writable && log->header->count < log->header->capacity;
+
+  munmap(log->header, log->mapsize);
+  if (trim && ftruncate(log->fd, used) != 0)
+    perror("evlog");
+  close(log->fd);
+  free(log);
+}
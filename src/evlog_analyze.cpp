@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include <utility>
+
+#include "../include/evlog.h"
+
+/* ******************************************************************
+ Offline analyzer for the binary event logs written with -e.
+
+   Prints a summary (event counts, message latency from layer 5 at the
+   sender to layer 5 at the receiver, retransmissions of data by A) and, on
+   request, CSV tables:
+     -m          per message: from,msg,created,delivered,latency
+     -p          per seqnum sent by A: seq,sends,first_send,last_send
+     -t width    goodput time series: time,delivered,goodput
+   Messages are numbered per sending entity; bidirectional (-b) logs
+   hold msgs from both A and B.
+   Retransmissions are counted per seqnum, which identifies a message
+   for GBN and SR; ABT reuses its two seqnums, so for ABT they count
+   resends of the alternating bit.
+
+   usage: evlog_analyze [-m] [-p] [-t width] logfile
+**********************************************************************/
+
+using namespace std;
+
+static const char *kind_name[EVLOG_KINDS] = {
+	"app", "send", "loss", "corrupt", "arrive", "deliver", "timer_start", "timer_stop", "timeout"
+};
+
+/* one message handed to an entity by layer 5 */
+struct message_times
+{
+	float created; // EVLOG_APP, -1 if before the oldest record
+	float delivered; // EVLOG_DELIVER at B, -1 if never delivered
+};
+
+/* transmissions of one seqnum by A */
+struct seq_sends
+{
+	int sends;
+	float first;
+	float last;
+};
+
+void display_usage(char *filename)
+{
+	fprintf(stderr, "Usage:\n %s [-m] [-p] [-t Time series bucket width] Event log file\n", filename);
+}
+
+int main(int argc, char **argv)
+{
+	bool perMessage = false, perSeq = false;
+	float width = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "mpt:")) != -1) {
+		switch (opt) {
+			case 'm': perMessage = true; break;
+			case 'p': perSeq = true; break;
+			case 't':
+				if ((width = atof(optarg)) <= 0) {
+					fprintf(stderr, "Invalid value for -%c\n", opt);
+					return -1;
+				}
+				break;
+			default: display_usage(argv[0]); return -1;
+		}
+	}
+	if (optind != argc - 1) {
+		display_usage(argv[0]);
+		return -1;
+	}
+	struct evlog *log = evlog_open(argv[optind]);
+	if (log == NULL) return 1;
+
+	uint64_t n = evlog_size(log);
+	long counts[EVLOG_KINDS][2] = {{0}};
+	map<pair<int, int>, struct message_times> messages; // by (sending entity, msg number)
+	map<int, struct seq_sends> seqs;
+	float start = n ? evlog_get(log, 0)->time : 0, end = start;
+
+	for (uint64_t i = 0; i < n; i++) {
+		const struct evlog_record *r = evlog_get(log, i);
+		if (r->kind >= EVLOG_KINDS || r->entity > 1) continue; // not a known record
+		counts[r->kind][r->entity]++;
+		end = r->time;
+		if (r->kind == EVLOG_APP) {
+			struct message_times &m = messages[make_pair((int)r->entity, r->seqnum)];
+			m.created = r->time;
+			m.delivered = -1;
+		} else if (r->kind == EVLOG_DELIVER) {
+			pair<int, int> key = make_pair(1 - r->entity, r->seqnum); // sent by the other entity
+			if (messages.find(key) == messages.end()) messages[key].created = -1;
+			messages[key].delivered = r->time;
+		} else if (r->kind == EVLOG_SEND && r->entity == 0 && r->seqnum >= 0) { // data, not a pure ACK
+			struct seq_sends &s = seqs[r->seqnum];
+			if (s.sends++ == 0) s.first = r->time;
+			s.last = r->time;
+		}
+	}
+
+	printf("records: %llu of %llu written (ring holds %llu)\n", (unsigned long long)n,
+	       (unsigned long long)log->header->count, (unsigned long long)log->header->capacity);
+	printf("time: %f to %f\n", start, end);
+	printf("%-12s %10s %10s\n", "event", "A", "B");
+	for (int k = 0; k < EVLOG_KINDS; k++) {
+		printf("%-12s %10ld %10ld\n", kind_name[k], counts[k][0], counts[k][1]);
+	}
+
+	long delivered = 0, timed = 0;
+	double sum = 0;
+	float lo = 0, hi = 0;
+	for (map<pair<int, int>, struct message_times>::iterator it = messages.begin(); it != messages.end(); ++it) {
+		if (it->second.delivered < 0) continue;
+		delivered++;
+		if (it->second.created < 0) continue; // created before the oldest record
+		float latency = it->second.delivered - it->second.created;
+		if (timed == 0 || latency < lo) lo = latency;
+		if (timed == 0 || latency > hi) hi = latency;
+		sum += latency;
+		timed++;
+	}
+	printf("messages: %ld created, %ld delivered\n", counts[EVLOG_APP][0] + counts[EVLOG_APP][1], delivered);
+	if (timed > 0) {
+		printf("latency: mean %f min %f max %f (%ld messages)\n", sum / timed, lo, hi, timed);
+	}
+
+	long sends = 0, resent = 0, most = 0;
+	for (map<int, struct seq_sends>::iterator it = seqs.begin(); it != seqs.end(); ++it) {
+		sends += it->second.sends;
+		if (it->second.sends > 1) resent++;
+		if (it->second.sends > most) most = it->second.sends;
+	}
+	printf("retransmissions by A: %ld of %ld sends (%ld seqnums, %ld resent, at most %ld sends each)\n",
+	       sends - (long)seqs.size(), sends, (long)seqs.size(), resent, most);
+	if (counts[EVLOG_DELIVER][1] > 0) {
+		printf("sends by A per message delivered at B: %f\n", (double)counts[EVLOG_SEND][0] / counts[EVLOG_DELIVER][1]);
+	}
+
+	if (perMessage) {
+		printf("\nfrom,msg,created,delivered,latency\n");
+		for (map<pair<int, int>, struct message_times>::iterator it = messages.begin(); it != messages.end(); ++it) {
+			const struct message_times &m = it->second;
+			printf("%c,%d,%f,%f,%f\n", it->first.first ? 'B' : 'A', it->first.second, m.created, m.delivered,
+			       (m.created >= 0 && m.delivered >= 0) ? m.delivered - m.created : -1.0f);
+		}
+	}
+	if (perSeq) {
+		printf("\nseq,sends,first_send,last_send\n");
+		for (map<int, struct seq_sends>::iterator it = seqs.begin(); it != seqs.end(); ++it) {
+			printf("%d,%d,%f,%f\n", it->first, it->second.sends, it->second.first, it->second.last);
+		}
+	}
+	if (width > 0 && n > 0) {
+		long buckets = (long)((end - start) / width) + 1;
+		long *perBucket = (long *)calloc(buckets, sizeof(long));
+		for (uint64_t i = 0; i < n; i++) {
+			const struct evlog_record *r = evlog_get(log, i);
+			if (r->kind == EVLOG_DELIVER) {
+				long b = (long)((r->time - start) / width);
+				if (b >= 0 && b < buckets) perBucket[b]++;
+			}
+		}
+		printf("\ntime,delivered,goodput\n");
+		for (long b = 0; b < buckets; b++) {
+			printf("%f,%ld,%f\n", start + b * width, perBucket[b], perBucket[b] / width);
+		}
+		free(perBucket);
+	}
+
+	evlog_close(log);
+	return 0;
+}
@@ -1,8 +1,12 @@
 #include "../include/simulator.h"
+#include "../include/rto.h"
+#include "../include/checksum.h"
+#include "../include/cwnd.h"
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
 #include <vector>
+#include <queue>
 /* ******************************************************************
  ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
 
@@ -21,86 +25,358 @@
 
 using namespace std;
 
-/* TIMEOUT_TIMEUNITS is constant for a set of expirements */
+/* TIMEOUT_TIMEUNITS is the initial timeout, until the first RTT is measured, */
+/* unless -T sets another one */
 #define TIMEOUT_TIMEUNITS 30.0 // 20.0, 30.0, 40.0, 50.0, 100.0
 
-/* generic structure for entity (A/B) state */
+/* duplicate ACKs that trigger a fast retransmit of the window (0 disables), */
+/* unless -D sets another threshold */
+#define DUPACK_THRESHOLD 3
+
+/* delayed ACKs: B acknowledges every DELAYED_ACK_COUNT in-order packets, or */
+/* DELAYED_ACK_TIMEUNITS after the oldest unacknowledged one (1 disables),   */
+/* unless -A sets another count                                              */
+#define DELAYED_ACK_COUNT 1
+#define DELAYED_ACK_TIMEUNITS 5.0
+
+/* piggybacked ACKs (bidirectional runs): 1 lets data packets carry the    */
+/* cumulative ACK of the peer's data, and holds in-order ACKs for outgoing */
+/* data to carry (sending one at least every PIGGYBACK_ACK_COUNT packets,  */
+/* or DELAYED_ACK_TIMEUNITS after the oldest); 0 sends every ACK on its own, */
+/* unless -P says otherwise                                                 */
+#define PIGGYBACK_ACKS 1
+#define PIGGYBACK_ACK_COUNT 2
+
+/* packet format: data packets carry seqnum >= 0; pure ACKs carry seqnum -1. */
+/* acknum is the last in-order seq received from the peer (-1 if none).     */
+
+/* generic structure for entity (A/B) state; each entity sends its own data */
+/* and receives the peer's */
 struct entity
 {
+	int id; // 0 for A, 1 for B (entity passed to the simulator routines)
 	int seq; // sequence number
-	int ack; // acknowledgment number
+	int ack; // acknowledgment number: next seq expected from the peer
 	int baseIndex; // base index of window
 	int windowSize; // window size
-	int idx; //
+	int idx; // next seq to be filled into the send window
+	int timedSeq; // seq being timed for an RTT sample, -1 if none
+	float timedSendTime; // time timedSeq was first sent
+	int dupAcks; // duplicate ACKs received for the current baseIndex
+	int dupAckThreshold; // dupAcks that trigger a fast retransmit (0 never)
+	int pendingAcks; // in-order packets received but not yet acknowledged
+	float ackDeadline; // time the pending ACKs must be sent by
+	int delayedAckCount; // in-order packets acknowledged at once (1 never delays)
+	bool isPiggybacking; // data carries the ACK of the peer's data
+	bool isRetransmitting; // retransmission timer of the window is running
+	float rtxDeadline; // and its expiry
+	// the hardware timer serves both deadlines: whether it runs, and the expiry it was armed for
+	bool isTimerRunning;
+	float timerDeadline;
+
+	// adaptive retransmission timeout
+	struct rto_estimator rto;
+	// congestion window
+	int cwndMode; // 1 limits the send window with slow start / AIMD (capped by -w), -W
+	struct cwnd_state cwnd;
+
+	// circular send window: seq s in [baseIndex, idx) lives in slot s % windowSize
+	vector<struct msg> messagesBuffer;
+	// msgs from layer 5 waiting for room in the send window
+	queue<struct msg> messagesBacklog;
+	// packets of the current send pass, handed to layer3 as one burst
+	vector<struct pkt> packetsBurst;
 };
-struct entity entity_A; // A
-struct entity entity_B; // B
-
-// buffer to store incoming msgs from layer 5
-// (only 1 buffer implemented for unidirectional transfer of data from the A-side to the B-side)
-vector<struct msg> messagesBuffer;
-
-/* helper method to compute checksum */
-/* INPUT: requires pointer to packet for which checksum is to be computed */
-/* OUTPUT: computed checksum */
-int get_checksum(struct pkt *packet)
-{
-    int localsum = 0;
-	int seqnum = packet->seqnum;
-	int acknum = packet->acknum;
-	int payloadsize = sizeof(packet->payload);
-
-    localsum += seqnum;
-    localsum += acknum;
-    for (int i = 0; i < payloadsize; i++) {
-		localsum += (packet->payload)[i];
-	}
-	// localsum = ~localsum; //bitswise NOT (optional logic)
-    return localsum;
+
+/* protocol state of one simulation; made by protocol_create() and owned by the simulation */
+struct protocol_state
+{
+	struct entity entity_A; // A
+	struct entity entity_B; // B
+};
+// state of the simulation running on this thread
+thread_local struct protocol_state *state = NULL;
+
+/* called by the simulator before A_init() and B_init(): fresh state for one simulation */
+/* OUTPUT: the new state, which also becomes the state of the calling thread */
+struct protocol_state *protocol_create()
+{
+	state = new protocol_state();
+	return state;
+}
+
+/* called by the simulator once the simulation is over */
+/* INPUT: state returned by protocol_create() */
+void protocol_destroy(struct protocol_state *ended)
+{
+	cwnd_close(&ended->entity_A.cwnd);
+	cwnd_close(&ended->entity_B.cwnd);
+	if (state == ended) state = NULL;
+	delete ended;
+	return;
 }
 
 /* helper method to create data packet from message received from layer5 */
-/* INPUT: message from layer5, entity which requested (A or B) */
-/* OUTPUT: pointer to created packet */
-struct pkt *create_data_packet(struct msg message, struct entity host)
-{
-    struct pkt *packet = new struct pkt;
-    packet->seqnum = host.seq;
-    packet->acknum = host.ack;
-    strcpy(packet->payload, message.data);
-    packet->checksum = get_checksum(packet);
+/* INPUT: pointer to message from layer5, entity which requested (A or B) */
+/* OUTPUT: created packet (by value, nothing to free) */
+struct pkt create_data_packet(const struct msg *message, const struct entity *host)
+{
+    struct pkt packet;
+    packet.seqnum = host->seq;
+    packet.acknum = host->ack - 1; // piggybacked cumulative ACK of the peer's data
+    packet.length = message->length;
+    memcpy(packet.payload, message->data, message->length); // data is not NUL-terminated
+    packet.checksum = get_checksum(&packet);
     return packet;
 }
 
 /* helper method to create ACK / NAK packets */
 /* INPUT: ack/nak number */
-/* OUTPUT: pointer to created packet */
-struct pkt *create_ack_packet(int ack_number)
+/* OUTPUT: created packet (by value, nothing to free) */
+struct pkt create_ack_packet(int ack_number)
 {
-    struct pkt *packet = new struct pkt;
-    packet->acknum = ack_number;
-    packet->checksum = get_checksum(packet);
+    struct pkt packet;
+    packet.seqnum = -1; // no data
+    packet.acknum = ack_number;
+    packet.length = 0; // no payload
+    packet.checksum = get_checksum(&packet);
     return packet;
 }
 
-/* helper method to access messagesBuffer and pass packets to layer3 */
-/* INPUT: pointer to incoming messsage or isInterrupt flag */
-void util_A_send_packets(struct msg *message, bool isInterrupt)
+/* helper method to get the number of in-order packets acknowledged at once */
+int util_ack_count(const struct entity *host)
 {
-	if (isInterrupt) {
+	if (host->isPiggybacking && getbidirectional() && host->delayedAckCount < PIGGYBACK_ACK_COUNT) {
+		return PIGGYBACK_ACK_COUNT; // give outgoing data the chance to carry the ACK
+	}
+	return host->delayedAckCount;
+}
+
+/* helper method to point the hardware timer at the earlier of the retransmission */
+/* and pending ACK deadlines, or stop it if neither is pending */
+void util_arm_timer(struct entity *host)
+{
+	bool isNeeded = host->isRetransmitting || host->pendingAcks > 0;
+	float deadline = host->isRetransmitting ? host->rtxDeadline : host->ackDeadline;
+	if (host->pendingAcks > 0 && host->ackDeadline < deadline) deadline = host->ackDeadline;
+	if (host->isTimerRunning && (!isNeeded || host->timerDeadline != deadline)) {
+		stoptimer(host->id);
+		host->isTimerRunning = false;
+	}
+	if (isNeeded && !host->isTimerRunning) {
+		starttimer(host->id, deadline - get_sim_time());
+		host->isTimerRunning = true;
+		host->timerDeadline = deadline;
+	}
+	return;
+}
+
+/* helper method to (re)start the retransmission timer of the window */
+void util_start_rtx_timer(struct entity *host)
+{
+	host->isRetransmitting = true;
+	host->rtxDeadline = get_sim_time() + rto_get(&host->rto);
+	util_arm_timer(host);
+	return;
+}
+
+/* helper method to stop the retransmission timer of the window */
+void util_stop_rtx_timer(struct entity *host)
+{
+	host->isRetransmitting = false;
+	util_arm_timer(host);
+	return;
+}
+
+/* helper method to clear pending ACKs once a packet carrying the cumulative ACK was sent */
+/* (a timer that has just fired is rearmed by the interrupt) */
+void util_acks_sent(struct entity *host)
+{
+	host->pendingAcks = 0;
+	if (host->isTimerRunning) util_arm_timer(host);
+	return;
+}
+
+/* helper method to get the number of seqs an entity may have in flight from baseIndex */
+int util_send_window(struct entity *host)
+{
+	return host->cwndMode ? cwnd_get(&host->cwnd) : host->windowSize;
+}
+
+/* helper method to access messagesBuffer and pass packets to layer3 (in one burst) */
+/* INPUT: sending entity, pointer to incoming messsage (or NULL), isGoBack flag (resend the window from baseIndex) */
+/* OUTPUT: number of packets sent */
+int util_send_packets(struct entity *host, struct msg *message, bool isGoBack)
+{
+	if (isGoBack) {
 		// reset seq to base index of window
-		entity_A.seq = entity_A.baseIndex;
+		host->seq = host->baseIndex;
+		// drop the RTT sample in progress (Karn's rule)
+		host->timedSeq = -1;
+	} else if (message != NULL) {
+		// queue incoming message until it fits in the window
+		host->messagesBacklog.push(*message);
+	}
+	bool sendsBase = host->seq == host->baseIndex;
+	host->packetsBurst.clear();
+	// loop to queue next seq if seq is in window and is in messagesBuffer or messagesBacklog
+	for (; host->seq < (host->baseIndex + util_send_window(host)); host->seq++) {
+		struct msg *slot = &host->messagesBuffer[host->seq % host->windowSize];
+		if (host->seq == host->idx) {
+			if (host->messagesBacklog.empty()) break;
+			// move next waiting message into its window slot
+			*slot = host->messagesBacklog.front();
+			host->messagesBacklog.pop();
+			host->idx++;
+			// first transmission of this seq; time it if nothing else is being timed
+			if (host->timedSeq < 0) {
+				host->timedSeq = host->seq;
+				host->timedSendTime = get_sim_time();
+			}
+		}
+		host->packetsBurst.push_back(create_data_packet(slot, host));
+	}
+	if (host->packetsBurst.empty()) return 0;
+	tolayer3_burst(host->id, host->packetsBurst.data(), host->packetsBurst.size());
+	if (host->isPiggybacking) util_acks_sent(host);
+	if (sendsBase) util_start_rtx_timer(host);
+	return (int)host->packetsBurst.size();
+}
+
+/* helper method for an entity to act on the peer's cumulative ACK */
+/* INPUT: receiving entity, ack number, isPure (a pure ACK, not piggybacked on data) */
+/* OUTPUT: number of packets sent in reply */
+int util_ack_received(struct entity *host, int acknum, bool isPure)
+{
+	// never slide the window backwards or past what has been filled
+	if (acknum + 1 > host->baseIndex && acknum < host->idx) {
+		if (host->cwndMode) cwnd_on_ack(&host->cwnd, acknum + 1 - host->baseIndex);
+		host->baseIndex = acknum + 1;
+		host->dupAcks = 0;
+		rto_ack(&host->rto);
+		if (host->timedSeq >= 0 && host->timedSeq < host->baseIndex) {
+			// timed seq has been cumulatively ackd
+			rto_sample(&host->rto, get_sim_time() - host->timedSendTime);
+			host->timedSeq = -1;
+		}
+		util_stop_rtx_timer(host);
+		if(host->baseIndex != host->seq) {
+			util_start_rtx_timer(host);
+		}
+		// with a congestion window the window slid and may have grown: send waiting
+		// messages that now fit; otherwise they wait for the next output or timeout
+		return host->cwndMode ? util_send_packets(host, NULL, false) : 0;
+	} else if (isPure && acknum + 1 == host->baseIndex && host->baseIndex != host->seq) {
+		// duplicate ACK: the peer got a later packet but is still missing baseIndex
+		// (data packets repeat the same ACK without signalling anything)
+		host->dupAcks++;
+		if (host->dupAcks == host->dupAckThreshold) {
+			// fast retransmit: go back now instead of waiting for the timer
+			if (host->cwndMode) cwnd_on_loss(&host->cwnd);
+			util_stop_rtx_timer(host);
+			return util_send_packets(host, NULL, true);
+		}
+	}
+	return 0;
+}
+
+/* helper method for an entity to send the cumulative ACK of the last in-order seq */
+/* (also covers, and so clears, any delayed ACKs) */
+void util_send_ack(struct entity *host)
+{
+	struct pkt ack_packet = create_ack_packet(host->ack - 1);
+	tolayer3(host->id, ack_packet);
+	util_acks_sent(host);
+	return;
+}
+
+/* helper method for an entity to take in a valid data packet from the peer */
+void util_data_received(struct entity *host, struct pkt *packet)
+{
+	if (packet->seqnum == host->ack) {
+		tolayer5(host->id, packet->payload, packet->length);
+		host->ack++;
+		// the ACK this packet carries may slide the window; the data sent then carries ours
+		if (host->isPiggybacking && util_ack_received(host, packet->acknum, false) > 0) {
+			return; // acknowledged by piggybacked data
+		}
+		if (host->pendingAcks++ == 0) {
+			host->ackDeadline = get_sim_time() + DELAYED_ACK_TIMEUNITS; // bound the delay of this ACK
+		}
+		if (host->pendingAcks >= util_ack_count(host)) {
+			util_send_ack(host);
+		} else if (host->pendingAcks == 1) {
+			util_arm_timer(host);
+		}
+	} else {
+		if (host->isPiggybacking) util_ack_received(host, packet->acknum, false);
+		// out-of-order packet: repeat the cumulative ACK of the last in-order seq at once
+		util_send_ack(host);
+	}
+	return;
+}
+
+/* helper method for an entity to take in a packet from layer3 */
+void util_input(struct entity *host, struct pkt *packet)
+{
+	if (packet->checksum != get_checksum(packet)) {
+		return; // return if packet is NOT valid
+	}
+	if (packet->seqnum < 0) {
+		util_ack_received(host, packet->acknum, true);
 	} else {
-		// add incoming message to buffer
-		messagesBuffer.push_back(*message);
+		util_data_received(host, packet);
 	}
-	// loop to send next seq if seq is in window and is messagesBuffer
-	for (; entity_A.seq < (entity_A.baseIndex + entity_A.windowSize) && entity_A.seq < messagesBuffer.size(); entity_A.seq++) {
-		struct msg message = messagesBuffer[entity_A.seq];
-		struct pkt *packet = create_data_packet(message, entity_A);
-		tolayer3(0, *packet);
-		if(entity_A.baseIndex == entity_A.seq) starttimer(0, TIMEOUT_TIMEUNITS);
+	return;
+}
+
+/* helper method for an entity's timer interrupt */
+void util_timerinterrupt(struct entity *host)
+{
+	float expired = host->timerDeadline;
+	host->isTimerRunning = false; // has fired
+	if (host->pendingAcks > 0 && host->ackDeadline <= expired) {
+		// flush delayed ACKs
+		util_send_ack(host);
 	}
+	if (host->isRetransmitting && host->rtxDeadline <= expired) {
+		host->isRetransmitting = false;
+		rto_backoff(&host->rto);
+		if (host->cwndMode) cwnd_on_timeout(&host->cwnd);
+		util_send_packets(host, NULL, true);
+	}
+	util_arm_timer(host); // for whichever deadline is left
+	return;
+}
+
+/* helper method to initialize the state of an entity */
+/* INPUT: entity, its id (0 for A, 1 for B), file for its cwnd trajectory (or NULL) */
+void util_init(struct entity *host, int id, const char *cwndTraceFile)
+{
+	host->id = id;
+	host->seq = 0;
+	host->ack = 0;
+	host->baseIndex = 0;
+	host->windowSize = getwinsize();
+	host->idx = 0;
+	host->timedSeq = -1;
+	host->dupAcks = 0;
+	host->dupAckThreshold = getdupackthreshold() < 0 ? DUPACK_THRESHOLD : getdupackthreshold();
+	host->pendingAcks = 0;
+	host->delayedAckCount = getdelayedackcount() < 0 ? DELAYED_ACK_COUNT : getdelayedackcount();
+	host->isPiggybacking = getpiggyback() < 0 ? PIGGYBACK_ACKS : getpiggyback();
+	host->isRetransmitting = false;
+	host->isTimerRunning = false;
+	host->messagesBuffer.resize(host->windowSize);
+	host->packetsBurst.reserve(host->windowSize);
+	// the last pkt of a full window queues behind the rest on a rate limited link;
+	// a spurious resend delays the pkts behind it and can time them out as well,
+	// so never time out sooner than the tuned timeout, whatever the queueing delay
+	float timeout = gettimeout() > 0 ? gettimeout() : TIMEOUT_TIMEUNITS;
+	rto_init(&host->rto, timeout, timeout, RTO_MAX, getlinkdelay(host->windowSize));
+	host->cwndMode = getcwndmode();
+	// the window only moves, and its trajectory is only written, in cwnd mode
+	cwnd_init(&host->cwnd, host->windowSize, host->cwndMode ? cwndTraceFile : NULL);
 	return;
 }
 
@@ -108,27 +384,21 @@ void util_A_send_packets(struct msg *message, bool isInterrupt)
 /* called from layer 5, passed the data to be sent to other side */
 void A_output(struct msg message)
 {
-	util_A_send_packets(&message, false);
+	util_send_packets(&state->entity_A, &message, false);
 	return;
 }
 
 /* called from layer 3, when a packet arrives for layer 4 */
 void A_input(struct pkt packet)
 {
-	if (packet.checksum == get_checksum(&packet)) { // if valid
-		entity_A.baseIndex = packet.acknum + 1;
-		stoptimer(0);
-		if(entity_A.baseIndex != entity_A.seq) {
-			starttimer(0, TIMEOUT_TIMEUNITS);
-		}
-	}
+	util_input(&state->entity_A, &packet);
 	return;
 }
 
 /* called when A's timer goes off */
 void A_timerinterrupt()
 {
-	util_A_send_packets(NULL, true);
+	util_timerinterrupt(&state->entity_A);
 	return;
 }
 
@@ -136,25 +406,28 @@ void A_timerinterrupt()
 /* entity A routines are called. You can use it to do any initialization */
 void A_init()
 {
-	entity_A.seq = 0;
-	entity_A.ack = 0;
-	entity_A.baseIndex = 0;
-	entity_A.windowSize = getwinsize();
-	entity_A.idx = 0;
+	util_init(&state->entity_A, 0, getcwndtrace());
 	return;
 }
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
+/* called from layer 5 at B (bidirectional runs only), passed the data to be sent to A */
+void B_output(struct msg message)
+{
+	util_send_packets(&state->entity_B, &message, false);
+	return;
+}
 
 /* called from layer 3, when a packet arrives for layer 4 at B*/
 void B_input(struct pkt packet)
-{	
-	if (packet.seqnum == entity_B.ack && packet.checksum == get_checksum(&packet)) { // if valid
-		tolayer5(1, packet.payload);
-		struct pkt *ack_packet = create_ack_packet(entity_B.ack);
-		tolayer3(1, *ack_packet);
-		entity_B.ack++;
-	}
+{
+	util_input(&state->entity_B, &packet);
+	return;
+}
+
+/* called when B's timer goes off */
+void B_timerinterrupt()
+{
+	util_timerinterrupt(&state->entity_B);
 	return;
 }
 
@@ -162,10 +435,6 @@ void B_input(struct pkt packet)
 /* entity B routines are called. You can use it to do any initialization */
 void B_init()
 {
-	entity_B.seq = 0; // unused as B is not transmitting app layer data to A
-	entity_B.ack = 0;
-	entity_B.baseIndex = 0;
-	entity_B.windowSize = getwinsize();
-	entity_B.idx = 0;
+	util_init(&state->entity_B, 1, NULL);
 	return;
 }
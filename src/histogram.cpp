@@ -0,0 +1,71 @@
+#include <math.h>
+#include <string.h>
+
+#include "../include/histogram.h"
+
+/* bucket holding value: exponent e of value = m * 2^e (0.5 <= m < 1) */
+/* picks the power of two, the mantissa the linear sub-bucket in it   */
+static int hist_bucket(float value)
+{
+  int e, i;
+  float m;
+
+  if (value <= 0)
+    return 0;
+  m = frexpf(value, &e);
+  if (e <= HIST_MIN_EXP)
+    return 0;
+  if (e > HIST_MAX_EXP)
+    return HIST_BUCKETS - 1;
+  i = (e - 1 - HIST_MIN_EXP) * HIST_SUB + (int)((m - 0.5f) * 2 * HIST_SUB);
+  return i < HIST_BUCKETS ? i : HIST_BUCKETS - 1;
+}
+
+/* largest value that falls into bucket i */
+static float hist_bucket_top(int i)
+{
+  int e = i / HIST_SUB + HIST_MIN_EXP;
+
+  return ldexpf(1.0f + (float)(i % HIST_SUB + 1) / HIST_SUB, e);
+}
+
+void hist_init(struct histogram *h)
+{
+  memset(h, 0, sizeof(*h));
+}
+
+void hist_record(struct histogram *h, float value)
+{
+  h->counts[hist_bucket(value)]++;
+  h->total++;
+  h->sum += value;
+  if (value > h->max)
+    h->max = value;
+}
+
+/* smallest bucket top with at least q of the values at or below it */
+/* (never more than the largest value recorded); 0 if empty          */
+float hist_percentile(const struct histogram *h, double q)
+{
+  long rank, seen = 0;
+  float top;
+  int i;
+
+  if (h->total == 0)
+    return 0;
+  rank = (long)ceil(q * h->total);
+  if (rank < 1)
+    rank = 1;
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen >= rank)
+      break;
+  }
+  top = hist_bucket_top(i);
+  return top < h->max ? top : h->max;
+}
+
+float hist_mean(const struct histogram *h)
+{
+  return h->total ? h->sum / h->total : 0;
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <ctype.h>
+
+#include "../include/simulator.h"
+
+/* Command line front end of the abt, gbn and sr simulators: parses the */
+/* options into a sim_config, runs simulate() and prints the report.    */
+
+/**
+ * Checks if the array pointed to by input holds a valid number.
+ *
+ * @param  input char* to the array holding the value.
+ * @return TRUE or FALSE
+ */
+int isNumber(char *input)
+{
+    while (*input){
+        if (!isdigit(*input))
+            return 0;
+        else
+            input += 1;
+    }
+
+    return 1;
+}
+
+int read_arg_int(char c)
+{
+    if(!isNumber(optarg)) {
+        fprintf(stderr, "Invalid value for -%c\n", c);
+        exit(-1);
+    }
+    return atoi(optarg);
+}
+
+float read_arg_float(char c)
+{
+    float val = atof(optarg);
+    if(val < 0.0 || val > 1.0){
+        fprintf(stderr, "Invalid value for -%c\n", c);
+        exit(-1);
+    }
+    return val;
+}
+
+void display_usage(char *filename)
+{
+    printf("Usage:\n %s -s Seed -w Window size -m Number of messages to simulate -l Loss -c Corruption -t Average time between messages from sender's layer5 -v Tracing [-r Random number generator: rand, xoshiro or pcg] [-e Event log file] [-b (bidirectional: layer5 sends from B too)] [-z Message size in bytes, 1 to %d] [-k Link rate in bytes per time unit, 0 for no serialization delay] [-D Duplicate ACKs for a fast retransmit, 0 disables] [-W Congestion window: 1 on, 0 off] [-C Congestion window trace file] [-T Initial timeout, 0 for the protocol's default] [-A In-order packets acknowledged at once, 1 disables delayed ACKs] [-P Piggybacked ACKs: 1 on, 0 off]\n", filename, PAYLOAD_MAX);
+}
+
+int main(int argc, char **argv)
+{
+   struct sim_config config;
+   struct sim_report report;
+   int status, delivered;
+
+   int opt;
+
+   /* -s -w -m -l -c -t -v are required (marked missing by -1), -r -e -b -z -k -D -W -C -T -A -P are optional */
+   config.seed = config.win_size = config.nsimmax = config.trace = -1;
+   config.lossprob = config.corruptprob = config.lambda = -1;
+   config.rng = RNG_RAND;
+   config.evlog_path = NULL;
+   config.trace_file = NULL;
+   config.bidirectional = 0;
+   config.msgsize = MSGSIZE_DEFAULT;
+   config.linkrate = 0;
+   config.dupack_threshold = -1;
+   config.cwnd_mode = 0;
+   config.cwnd_trace_path = NULL;
+   config.timeout = 0;
+   config.delayed_ack_count = -1;
+   config.piggyback = -1;
+
+   /*
+    * Parse the arguments
+    * http://www.gnu.org/software/libc/manual/html_node/Example-of-Getopt.html
+    */
+    while((opt = getopt(argc, argv,"s:w:m:l:c:t:v:r:e:bz:k:D:W:C:T:A:P:")) != -1){
+        switch (opt){
+            case 's':   config.seed = read_arg_int(opt);
+                        break;
+            case 'w':   config.win_size = read_arg_int(opt);
+                        break;
+            case 'm':     config.nsimmax = read_arg_int(opt);
+                        break;
+            case 'l':     config.lossprob = read_arg_float(opt);
+                        break;
+            case 'c':     config.corruptprob = read_arg_float(opt);
+                        break;
+            case 't':     if((config.lambda = atof(optarg)) <= 0.0){
+                            fprintf(stderr, "Invalid value for -%c\n", opt);
+                            exit(-1);
+                        }
+                        break;
+            case 'v':     config.trace = read_arg_int(opt);
+                        break;
+            case 'r':     if((config.rng = rng_kind(optarg)) < 0){
+                            fprintf(stderr, "Invalid value for -%c\n", opt);
+                            exit(-1);
+                        }
+                        break;
+            case 'e':     config.evlog_path = optarg;
+                        break;
+            case 'b':     config.bidirectional = 1;
+                        break;
+            case 'z':     config.msgsize = read_arg_int(opt);
+                        if(config.msgsize < 1 || config.msgsize > PAYLOAD_MAX){
+                            fprintf(stderr, "Invalid value for -%c (1 to %d, see PAYLOAD_MAX)\n", opt, PAYLOAD_MAX);
+                            exit(-1);
+                        }
+                        break;
+            case 'k':     if((config.linkrate = atof(optarg)) < 0.0){
+                            fprintf(stderr, "Invalid value for -%c\n", opt);
+                            exit(-1);
+                        }
+                        break;
+            case 'D':     config.dupack_threshold = read_arg_int(opt);
+                        break;
+            case 'W':     config.cwnd_mode = read_arg_int(opt);
+                        break;
+            case 'C':     config.cwnd_trace_path = optarg;
+                        break;
+            case 'T':     if((config.timeout = atof(optarg)) < 0.0){
+                            fprintf(stderr, "Invalid value for -%c\n", opt);
+                            exit(-1);
+                        }
+                        break;
+            case 'A':     if((config.delayed_ack_count = read_arg_int(opt)) < 1){
+                            fprintf(stderr, "Invalid value for -%c\n", opt);
+                            exit(-1);
+                        }
+                        break;
+            case 'P':     if((config.piggyback = read_arg_int(opt)) > 1){
+                            fprintf(stderr, "Invalid value for -%c\n", opt);
+                            exit(-1);
+                        }
+                        break;
+            case '?':
+               default:    fprintf(stderr, "Invalid arguments!\n");
+                        display_usage(argv[0]);
+                        return -1;
+       }
+    }
+
+   //Check for number of arguments
+   if(config.seed < 0 || config.win_size < 0 || config.nsimmax < 0 || config.trace < 0 ||
+      config.lossprob < 0 || config.corruptprob < 0 || config.lambda < 0 || optind != argc){
+           fprintf(stderr, "Missing arguments!\n");
+        display_usage(argv[0]);
+        return -1;
+   }
+   if(config.cwnd_trace_path != NULL && !config.cwnd_mode){
+        fprintf(stderr, "Invalid value for -C (needs -W 1, the window does not move otherwise)\n");
+        return -1;
+   }
+
+   status = simulate(&config, &report);
+   if (status != 0)
+      return status;           /* a delivery check failed, or the run could not start */
+
+   //Do NOT change any of the following printfs
+   printf(" Simulator terminated at time %f\n after sending %d msgs from layer5\n",report.time_local,report.nsim);
+
+   printf("\n");
+   printf("[PA2]%d packets sent from the Application Layer of Sender A[/PA2]\n", report.A_application);
+   printf("[PA2]%d packets sent from the Transport Layer of Sender A[/PA2]\n", report.A_transport);
+   printf("[PA2]%d packets received at the Transport layer of Receiver B[/PA2]\n", report.B_transport);
+   printf("[PA2]%d packets received at the Application layer of Receiver B[/PA2]\n", report.B_application);
+   printf("[PA2]Total time: %f time units[/PA2]\n", report.time_local);
+   printf("[PA2]Throughput: %f packets/time units[/PA2]\n", report.B_application/report.time_local);
+   printf("Latency: mean %f p50 %f p99 %f p999 %f max %f time units\n", report.latency_mean,
+      report.latency_p50, report.latency_p99, report.latency_p999, report.latency_max);
+   printf("Retransmission overhead: %f transport packets per application packet\n",
+      report.A_application ? (float)report.A_transport/report.A_application : 0.0f);
+   printf("Goodput: %f bytes/time units (%d byte msgs)\n",
+      (float)report.B_application*config.msgsize/report.time_local, config.msgsize);
+   if (config.bidirectional) {
+      /* both entities send data, so both sides' packets (data and ACKs) count */
+      delivered = report.B_application + report.A_application_recv;
+      printf("Reverse traffic: %d packets sent from the Application Layer of B, %d received at the Application layer of A\n",
+         report.B_application_sent, report.A_application_recv);
+      printf("Transport traffic: %d packets sent from A, %d sent from B, %f per delivered packet\n",
+         report.A_transport, report.B_transport_sent,
+         delivered ? (float)(report.A_transport + report.B_transport_sent)/delivered : 0.0f);
+      }
+   return 0;
+}
@@ -0,0 +1,79 @@
+#include "../include/rto.h"
+
+/* gains for the SRTT and RTTVAR moving averages, and the RTTVAR multiplier */
+#define RTO_ALPHA 0.125
+#define RTO_BETA  0.25
+#define RTO_K     4.0
+
+/* clamp a timeout into [min_rto, max_rto] */
+static float rto_clamp(struct rto_estimator *est, float rto)
+{
+  if (rto < est->min_rto)
+    return est->min_rto;
+  if (rto > est->max_rto)
+    return est->max_rto;
+  return rto;
+}
+
+/* reset the estimator; initial_rto is used until the first RTT sample and */
+/* timeouts, backed off or not, stay within [min_rto, max_rto]: a sender   */
+/* bounds them by its own tuned timeout on the side where a wrong timeout  */
+/* costs it most. The bounds are widened to take in initial_rto, so a     */
+/* timeout tuned past RTO_MAX (or below RTO_MIN) is used as given.         */
+/* queue_delay is how long a packet may wait behind the sender's own       */
+/* window on a rate limited link (0 if none); it is added to all the       */
+/* bounds, as RTT samples there mostly measure how full that queue was.    */
+void rto_init(struct rto_estimator *est, float initial_rto, float min_rto, float max_rto, float queue_delay)
+{
+  est->srtt = 0;
+  est->rttvar = 0;
+  if (min_rto > initial_rto)
+    min_rto = initial_rto;
+  if (max_rto < initial_rto)
+    max_rto = initial_rto;
+  est->min_rto = min_rto + queue_delay;
+  est->max_rto = max_rto + queue_delay;
+  est->rto = rto_clamp(est, initial_rto + queue_delay);
+  est->backoff = 0;
+  est->has_sample = 0;
+}
+
+/* fold a measured round trip time into the estimate */
+void rto_sample(struct rto_estimator *est, float rtt)
+{
+  float err;
+
+  if (!est->has_sample) {
+    est->srtt = rtt;
+    est->rttvar = rtt/2;
+    est->has_sample = 1;
+  } else {
+    err = est->srtt - rtt;
+    if (err < 0)
+      err = -err;
+    est->rttvar = (1 - RTO_BETA)*est->rttvar + RTO_BETA*err;
+    est->srtt = (1 - RTO_ALPHA)*est->srtt + RTO_ALPHA*rtt;
+  }
+  est->rto = rto_clamp(est, est->srtt + RTO_K*est->rttvar);
+}
+
+/* double the timeout after it expired without an ACK */
+void rto_backoff(struct rto_estimator *est)
+{
+  if (est->backoff < RTO_MAX_BACKOFF)
+    est->backoff++;
+}
+
+/* new data was acknowledged, so the path is alive again: drop the backoff. */
+/* Losses here are random rather than congestive, so keeping a backed off  */
+/* timeout until the next clean sample would only stall the sender.        */
+void rto_ack(struct rto_estimator *est)
+{
+  est->backoff = 0;
+}
+
+/* current retransmission timeout, including backoff */
+float rto_get(struct rto_estimator *est)
+{
+  return rto_clamp(est, est->rto * (1 << est->backoff));
+}
@@ -1,43 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <getopt.h>
-#include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
 
 #include "../include/simulator.h"
-
-/* Statistics */
-int A_application = 0;
-int A_transport = 0;
-int B_application = 0;
-int B_transport = 0;
-
-int win_size;
-
-int TRACE = 1;             /* for my debugging */
-int nsim = 0;              /* number of messages from 5 to 4 so far */
-int nsimmax = 0;           /* number of msgs to generate, then stop */
-float time_local = 0;
-float lossprob;            /* probability that a packet is dropped  */
-float corruptprob;         /* probability that one bit is packet is flipped */
-float lambda;              /* arrival rate of messages from layer 5 */
-int   ntolayer3;           /* number sent into layer 3 */
-int   nlost;               /* number lost in media */
-int ncorrupt;              /* number corrupted by media*/
-
-/****************************************************************************/
-/* jimsrand(): return a float in range [0,1].  The routine below is used to */
-/* isolate all random number generation in one location.  We assume that the*/
-/* system-supplied rand() function return an int in therange [0,mmm]        */
-/****************************************************************************/
-float jimsrand()
-{
-  double mmm = 2147483647;   /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
-  float x;                   /* individual students may need to change mmm */
-  x = rand()/mmm;            /* x should be uniform in [0,1] */
-  return(x);
-}
-
+#include "../include/evlog.h"
+#include "../include/histogram.h"
 
 /*****************************************************************
 ***************** NETWORK EMULATION CODE IS BELOW ***********
@@ -67,60 +36,491 @@ to, and you defeinitely should not have to modify
 #define   A    0
 #define   B    1
 
+/* payloads up to EVINLINE bytes (the default msg size and SR's bitmaps) */
+/* travel inside their arrival event, longer ones in a block of their   */
+/* own, so events stay small whatever PAYLOAD_MAX is                     */
+#define  EVINLINE        32
 
 struct event {
    float evtime;           /* event time */
    int evtype;             /* event type code */
    int eventity;           /* entity where event occurs */
-   struct pkt *pktptr;     /* ptr to packet (if any) assoc w/ this event */
-   struct event *prev;
-   struct event *next;
+   unsigned long evseq;    /* insertion order, breaks ties on evtime */
+   int heapidx;            /* position of this event in evheap */
+   struct event *nextfree; /* link while the event sits on evfreelist */
+   /* packet (if any) carried by this event: its header fields, and the */
+   /* evpaylen payload bytes it holds at evpayload                      */
+   int evseqnum, evacknum, evchecksum, evlength;
+   int evpaylen;
+   char *evpayload;        /* evinline, or a block of its own; NULL if no packet */
+   char evinline[EVINLINE];
  };
-struct event *evlist = NULL;   /* the event list */
 
-/* msg_track */
+/* recycled events are refilled at least EVSLAB events at a time; the slabs */
+/* are only freed with the simulation */
+#define  EVSLAB          256
+
+/* msg_track: ring of the messages handed to an entity but not yet verified */
+/* at the other one; there is one ring per direction, indexed by sender.     */
+/* Message n lives in slot n & (msgtrack_cap-1); the ring doubles when the   */
+/* backlog fills it, so memory follows the outstanding count, not -m.        */
+/* Generated msgs are one letter repeated, so the letter and the length   */
+/* stand for the msg chars.                                               */
+#define  MSGTRACK_INIT   1024
 struct msg_track {
-  char msg_chars[20];
+  char fill;               /* letter every byte of the msg holds */
+  int length;              /* bytes of data in the msg */
   int delivered;
-}application_msgs[1000];
-int cur_msg_sent = 0, cur_msg_recv = 0;
+  float created;           /* time the msg was handed to A_output()/B_output() */
+};
+
+/* glibc random() state size used by rand() (TYPE_3), so runs reproduce rand() */
+#define  RNGSTATE        128
+
+/* Everything one simulation owns. The simulator routines work on the */
+/* simulation running on the calling thread, sim.                     */
+struct simulation {
+   /* Statistics */
+   int A_application;
+   int A_transport;
+   int B_application;
+   int B_transport;
+   /* reverse direction (B to A) */
+   int B_application_sent;
+   int B_transport_sent;
+   int A_transport_recv;
+   int A_application_recv;
+
+   int win_size;
+   int bidirectional;         /* layer 5 hands msgs to both A and B */
+   int msgsize;               /* bytes of data in each generated msg */
+   float linkrate;            /* bytes per time unit, 0 for no serialization delay */
+   int dupack_threshold;      /* for the protocol: -1 leaves its default */
+   int cwnd_mode;             /* for the protocol: nonzero for a congestion window */
+   const char *cwnd_trace_path; /* for the protocol: A's cwnd trajectory, or NULL */
+   float timeout;             /* for the protocol: 0 leaves its initial timeout */
+   int delayed_ack_count;     /* for the protocol: -1 leaves its default */
+   int piggyback;             /* for the protocol: -1 leaves its default */
+
+   int TRACE;                 /* for my debugging */
+   int nsim;                  /* number of messages from 5 to 4 so far */
+   int nsimmax;               /* number of msgs to generate, then stop */
+   float time_local;
+   float lossprob;            /* probability that a packet is dropped  */
+   float corruptprob;         /* probability that one bit is packet is flipped */
+   float lambda;              /* arrival rate of messages from layer 5 */
+   int   ntolayer3;           /* number sent into layer 3 */
+   int   nlost;               /* number lost in media */
+   int ncorrupt;              /* number corrupted by media*/
+
+   /* random number generator behind jimsrand() (one of the RNG_* kinds) */
+   int rngkind;
+   struct random_data rng;    /* RNG_RAND */
+   char rngstate[RNGSTATE];
+   uint64_t xoshiro[4];       /* RNG_XOSHIRO */
+   uint64_t pcgstate, pcginc; /* RNG_PCG */
+
+   /* the event list: a binary min-heap ordered on (evtime, newest first). */
+   /* Equal-time events pop newest first, exactly as the original sorted   */
+   /* linked list did when it inserted ahead of the first equal entry.     */
+   struct event **evheap;
+   int evheap_size;
+   int evheap_cap;
+   unsigned long evseq_next;
+
+   /* pending TIMER_INTERRUPT event of each entity, NULL if its timer is off */
+   struct event *timerevent[2];
+
+   /* latest arrival time scheduled so far for packets headed to each entity */
+   float lastarrival[2];
+
+   /* time the link of each entity finishes sending its latest frame */
+   float linkfree[2];
+
+   /* recycled events, and the slabs they were carved from */
+   struct event *evfreelist;
+   int evfreecount;
+   struct event **evslabs;
+   int nevslabs;
+
+   /* delivery trackers of A to B and B to A (see msg_track) */
+   struct msg_track *application_msgs[2];
+   int msgtrack_cap[2];
+   int cur_msg_sent[2], cur_msg_recv[2];
+
+   /* latency of each delivered msg, from A_output()/B_output() to tolayer5() */
+   struct histogram latency;
+
+   /* binary event log (-e), or NULL */
+   struct evlog *evlog;
+
+   /* buffered trace output (see tracef), and where it is written */
+   FILE *traceout;
+   char *tracebuf;
+   int tracelen;
+
+   struct protocol_state *protocol;
+   int status;                /* 0, or the exit code of a failed delivery check */
+};
+
+/* the simulation running on this thread */
+thread_local struct simulation *sim = NULL;
+
+/* Trace levels above TRACE_MAX are compiled out, whatever -v asks for; */
+/* the sweeps, which never trace, link a copy built with TRACE_MAX=0.  */
+#ifndef TRACE_MAX
+#define TRACE_MAX 3
+#endif
+#define TRACING(level) (TRACE_MAX >= (level) && sim->TRACE >= (level))
+
+/* record an event of the running simulation in its event log, if it keeps one */
+void logevent(int kind, int entity, int seqnum, int acknum)
+{
+   if (sim->evlog != NULL)
+      evlog_write(sim->evlog, sim->time_local, kind, entity, seqnum, acknum);
+}
 
+/* trace output is collected per simulation and written TRACEBUF bytes */
+/* at a time (and when the simulation ends) instead of line by line    */
+#define  TRACEBUF        65536
 
-void insertevent(struct event *p)
+/* write out the buffered trace output */
+void trace_flush()
 {
-   struct event *q,*qold;
+   if (sim->tracelen > 0)
+      fwrite(sim->tracebuf, 1, sim->tracelen, sim->traceout);
+   sim->tracelen = 0;
+}
 
-   if (TRACE>2) {
-      printf("            INSERTEVENT: time is %lf\n",time_local);
-      printf("            INSERTEVENT: future time will be %lf\n",p->evtime);
+/* printf() into the trace buffer of the running simulation */
+void tracef(const char *fmt, ...)
+{
+   va_list ap;
+   int n, room;
+
+   if (sim->tracebuf == NULL) {
+      sim->tracebuf = (char *)malloc(TRACEBUF);
+      if (sim->tracebuf == NULL) {
+         printf("INTERNAL PANIC: unable to allocate trace buffer\n");
+         exit(1);
+         }
       }
-   q = evlist;     /* q points to header of list in which p struct inserted */
-   if (q==NULL) {   /* list is empty */
-        evlist=p;
-        p->next=NULL;
-        p->prev=NULL;
-        }
-     else {
-        for (qold = q; q !=NULL && p->evtime > q->evtime; q=q->next)
-              qold=q;
-        if (q==NULL) {   /* end of list */
-             qold->next = p;
-             p->prev = qold;
-             p->next = NULL;
-             }
-           else if (q==evlist) { /* front of list */
-             p->next=evlist;
-             p->prev=NULL;
-             p->next->prev=p;
-             evlist = p;
-             }
-           else {     /* middle of list */
-             p->next=q;
-             p->prev=q->prev;
-             q->prev->next=p;
-             q->prev=p;
-             }
+   room = TRACEBUF - sim->tracelen;
+   if (strchr(fmt, '%') == NULL) {   /* plain text: no need to format */
+      n = strlen(fmt);
+      if (n >= room)
+         trace_flush();
+      if (n < TRACEBUF) {
+         memcpy(sim->tracebuf + sim->tracelen, fmt, n);
+         sim->tracelen += n;
+         }
+      return;
+      }
+   va_start(ap, fmt);
+   n = vsnprintf(sim->tracebuf + sim->tracelen, room, fmt, ap);
+   va_end(ap);
+   if (n >= room) {             /* did not fit: flush, then format again */
+      trace_flush();
+      va_start(ap, fmt);
+      n = vsnprintf(sim->tracebuf, TRACEBUF, fmt, ap);
+      va_end(ap);
+      if (n >= TRACEBUF)
+         n = TRACEBUF-1;        /* truncated */
+      }
+   if (n > 0)
+      sim->tracelen += n;
+}
+
+/* trace at most TRACE_PAYLOAD bytes of a payload, then its length if longer */
+#define  TRACE_PAYLOAD   20
+void trace_payload(const char *data, int length)
+{
+   int i;
+
+   for (i=0; i<length && i<TRACE_PAYLOAD; i++)
+      tracef("%c", data[i]);
+   if (length > TRACE_PAYLOAD)
+      tracef("... (%d bytes)", length);
+}
+
+/* payload bytes of a packet in use, kept within the payload array */
+int pkt_length(const struct pkt *packet)
+{
+   if (packet->length < 0)
+      return 0;
+   if (packet->length > PAYLOAD_MAX)
+      return PAYLOAD_MAX;
+   return packet->length;
+}
+
+/* splitmix64, used to expand a seed into generator state */
+uint64_t splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+uint64_t rotl64(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+/* xoshiro256** (Blackman, Vigna) */
+uint64_t xoshiro_next(uint64_t *s)
+{
+  uint64_t result = rotl64(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl64(s[3], 45);
+  return result;
+}
+
+/* PCG32, XSH RR output (O'Neill) */
+uint32_t pcg_next()
+{
+  uint64_t old = sim->pcgstate;
+  uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+  uint32_t rot = (uint32_t)(old >> 59);
+
+  sim->pcgstate = old * 6364136223846793005ULL + sim->pcginc;
+  return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+/* seed the generator of the running simulation */
+void seedrng(int kind, int seed)
+{
+  uint64_t x = (uint32_t)seed;
+  int i;
+
+  sim->rngkind = kind;
+  switch (kind) {
+    case RNG_XOSHIRO:
+      for (i=0; i<4; i++)
+         sim->xoshiro[i] = splitmix64(&x);
+      break;
+    case RNG_PCG:
+      sim->pcgstate = 0;
+      sim->pcginc = (0xda3e39cb94b95bdbULL << 1) | 1;  /* default PCG32 stream */
+      pcg_next();
+      sim->pcgstate += x;
+      pcg_next();
+      break;
+    default:
+      initstate_r(seed, sim->rngstate, RNGSTATE, &sim->rng);
+      break;
+    }
+}
+
+/****************************************************************************/
+/* jimsrand(): return a float in range [0,1].  The routine below is used to */
+/* isolate all random number generation in one location.  We assume that the*/
+/* system-supplied rand() function return an int in therange [0,mmm]; each */
+/* simulation draws from its own random() state so that runs are re-entrant */
+/* xoshiro and pcg draw 24 bits, exactly what a float holds, so they give   */
+/* the same stream on every platform                                        */
+/****************************************************************************/
+float jimsrand()
+{
+  double mmm = 2147483647;   /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
+  float x;                   /* individual students may need to change mmm */
+  int32_t r;
+
+  switch (sim->rngkind) {
+    case RNG_XOSHIRO:
+      return (xoshiro_next(sim->xoshiro) >> 40) * (1.0f/16777216);
+    case RNG_PCG:
+      return (pcg_next() >> 8) * (1.0f/16777216);
+    }
+  random_r(&sim->rng, &r);   /* same sequence as rand() after srand(seed) */
+  x = r/mmm;                 /* x should be uniform in [0,1] */
+  return(x);
+}
+
+
+/* make sure at least n events are on the free list, carving the shortfall */
+/* (but no less than EVSLAB) as a single block */
+void evreserve(int n)
+{
+   struct event *p;
+   int i, count;
+
+   if (sim->evfreecount >= n)
+      return;
+   count = n - sim->evfreecount;
+   if (count < EVSLAB)
+      count = EVSLAB;
+   p = (struct event *)malloc(count*sizeof(struct event));
+   if (p == NULL) {
+      trace_flush();
+      printf("INTERNAL PANIC: unable to allocate events\n");
+      exit(1);
+      }
+   sim->evslabs = (struct event **)realloc(sim->evslabs, (sim->nevslabs+1)*sizeof(struct event *));
+   if (sim->evslabs == NULL) {
+      trace_flush();
+      printf("INTERNAL PANIC: unable to allocate events\n");
+      exit(1);
+      }
+   sim->evslabs[sim->nevslabs++] = p;
+   for (i=count-1; i>=0; i--) {
+      p[i].nextfree = sim->evfreelist;
+      sim->evfreelist = &p[i];
+      }
+   sim->evfreecount += count;
+}
+
+/* take an event off the free list, carving a new slab if it is empty */
+struct event *allocevent()
+{
+   struct event *p;
+
+   evreserve(1);
+   p = sim->evfreelist;
+   sim->evfreelist = p->nextfree;
+   sim->evfreecount--;
+   p->evpayload = NULL;
+   return p;
+}
+
+/* return an event (and the packet carried by it) to the free list */
+void freeevent(struct event *p)
+{
+   if (p->evpayload != p->evinline)
+      free(p->evpayload);
+   p->nextfree = sim->evfreelist;
+   sim->evfreelist = p;
+   sim->evfreecount++;
+}
+
+/* slot tracking message number n sent by entity from */
+/* (valid for cur_msg_recv[from]-1 <= n < cur_msg_sent[from]) */
+struct msg_track *msg_track_slot(int from, int n)
+{
+   return &sim->application_msgs[from][n & (sim->msgtrack_cap[from]-1)];
+}
+
+/* make room to track one more message sent by entity from, growing the */
+/* ring if needed; the last delivered message is kept for the in-order   */
+/* check in tolayer5 */
+void msg_track_reserve(int from)
+{
+   struct msg_track *old = sim->application_msgs[from];
+   int oldcap = sim->msgtrack_cap[from];
+   int n;
+
+   if (sim->cur_msg_sent[from] - sim->cur_msg_recv[from] + 1 < oldcap)
+      return;
+   sim->msgtrack_cap[from] = oldcap ? 2*oldcap : MSGTRACK_INIT;
+   sim->application_msgs[from] = (struct msg_track *)malloc(sim->msgtrack_cap[from]*sizeof(struct msg_track));
+   if (sim->application_msgs[from] == NULL) {
+      trace_flush();
+      printf("INTERNAL PANIC: unable to grow message tracker\n");
+      exit(1);
+      }
+   for (n = sim->cur_msg_recv[from]-1; oldcap && n < sim->cur_msg_sent[from]; n++)
+      if (n >= 0)
+         *msg_track_slot(from, n) = old[n & (oldcap-1)];
+   free(old);
+}
+
+/* returns nonzero if event p must be simulated before event q */
+int evbefore(struct event *p, struct event *q)
+{
+   if (p->evtime != q->evtime)
+      return p->evtime < q->evtime;
+   return p->evseq > q->evseq;
+}
+
+void evheap_set(int i, struct event *p)
+{
+   sim->evheap[i] = p;
+   p->heapidx = i;
+}
+
+void evheap_siftup(int i)
+{
+   struct event *p = sim->evheap[i];
+   int parent;
+
+   while (i > 0) {
+      parent = (i-1)/2;
+      if (!evbefore(p, sim->evheap[parent]))
+         break;
+      evheap_set(i, sim->evheap[parent]);
+      i = parent;
+      }
+   evheap_set(i, p);
+}
+
+void evheap_siftdown(int i)
+{
+   struct event *p = sim->evheap[i];
+   int child;
+
+   while ((child = 2*i+1) < sim->evheap_size) {
+      if (child+1 < sim->evheap_size && evbefore(sim->evheap[child+1], sim->evheap[child]))
+         child++;
+      if (!evbefore(sim->evheap[child], p))
+         break;
+      evheap_set(i, sim->evheap[child]);
+      i = child;
+      }
+   evheap_set(i, p);
+}
+
+void insertevent(struct event *p)
+{
+   if (TRACING(3)) {
+      tracef("            INSERTEVENT: time is %lf\n",sim->time_local);
+      tracef("            INSERTEVENT: future time will be %lf\n",p->evtime);
+      }
+   if (sim->evheap_size == sim->evheap_cap) {
+      sim->evheap_cap = sim->evheap_cap ? 2*sim->evheap_cap : 64;
+      sim->evheap = (struct event **)realloc(sim->evheap, sim->evheap_cap*sizeof(struct event *));
+      if (sim->evheap == NULL) {
+         trace_flush();
+         printf("INTERNAL PANIC: unable to grow event list\n");
+         exit(1);
          }
+      }
+   p->evseq = sim->evseq_next++;
+   evheap_set(sim->evheap_size, p);
+   sim->evheap_size++;
+   evheap_siftup(p->heapidx);
+}
+
+/* unlink event p (which must be on the event list) from the event list */
+void removeevent(struct event *p)
+{
+   int i = p->heapidx;
+
+   sim->evheap_size--;
+   if (i == sim->evheap_size)
+      return;
+   evheap_set(i, sim->evheap[sim->evheap_size]);
+   if (i > 0 && evbefore(sim->evheap[i], sim->evheap[(i-1)/2]))
+      evheap_siftup(i);
+   else
+      evheap_siftdown(i);
+}
+
+/* remove and return the earliest event, or NULL if the list is empty */
+struct event *popevent()
+{
+   struct event *p;
+
+   if (sim->evheap_size == 0)
+      return NULL;
+   p = sim->evheap[0];
+   removeevent(p);
+   return p;
 }
 
 
@@ -139,16 +539,16 @@ void generate_next_arrival()
    float ttime;
    int tempint;
 
-   if (TRACE>2)
-       printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
+   if (TRACING(3))
+       tracef("          GENERATE NEXT ARRIVAL: creating new arrival\n");
 
-   x = lambda*jimsrand()*2;  /* x is uniform on [0,2*lambda] */
+   x = sim->lambda*jimsrand()*2;  /* x is uniform on [0,2*lambda] */
                              /* having mean of lambda        */
 
-   evptr = (struct event *)malloc(sizeof(struct event));
-   evptr->evtime =  time_local + x;
+   evptr = allocevent();
+   evptr->evtime =  sim->time_local + x;
    evptr->evtype =  FROM_LAYER5;
-   if (BIDIRECTIONAL && (jimsrand()>0.5) )
+   if (sim->bidirectional && (jimsrand()>0.5) )
       evptr->eventity = B;
     else
       evptr->eventity = A;
@@ -159,7 +559,8 @@ void generate_next_arrival()
 
 
 
-void init(int seed)                         /* initialize the simulator */
+/* initialize the simulator; returns 0, or SIM_RNG_FAILED */
+int init(int seed, int rngkind)
 {
   int i;
   float sum, avg;
@@ -179,24 +580,25 @@ void init(int seed)                         /* initialize the simulator */
    scanf("%d",&TRACE);
    */
 
-   srand(seed);              /* init random number generator */
+   seedrng(rngkind, seed);   /* init random number generator */
    sum = 0.0;                /* test random number generator for students */
-   for (i=0; i<1000; i++)
+   for (i=0; rngkind == RNG_RAND && i<1000; i++)
       sum=sum+jimsrand();    /* jimsrand() should be uniform in [0,1] */
-   avg = sum/1000.0;
-   if (avg < 0.25 || avg > 0.75) {
+   avg = sum/1000.0;         /* (xoshiro and pcg are portable, no need) */
+   if (rngkind == RNG_RAND && (avg < 0.25 || avg > 0.75)) {
     printf("It is likely that random number generation on your machine\n" );
     printf("is different from what this emulator expects.  Please take\n");
     printf("a look at the routine jimsrand() in the emulator code. Sorry. \n");
-    exit(0);
+    return SIM_RNG_FAILED;
     }
 
-   ntolayer3 = 0;
-   nlost = 0;
-   ncorrupt = 0;
+   sim->ntolayer3 = 0;
+   sim->nlost = 0;
+   sim->ncorrupt = 0;
 
-   time_local=0;                    /* initialize time to 0.0 */
+   sim->time_local=0;                    /* initialize time to 0.0 */
    generate_next_arrival();     /* initialize event list */
+   return 0;
 }
 
 
@@ -215,194 +617,199 @@ void init(int seed)                         /* initialize the simulator */
 //int   nlost;               /* number lost in media */
 //int ncorrupt;              /* number corrupted by media*/
 
-/**
- * Checks if the array pointed to by input holds a valid number.
- *
- * @param  input char* to the array holding the value.
- * @return TRUE or FALSE
- */
-int isNumber(char *input)
-{
-    while (*input){
-        if (!isdigit(*input))
-            return 0;
-        else
-            input += 1;
-    }
-
-    return 1;
-}
-
-int read_arg_int(char c)
+/* RNG_* kind named by a -r argument, or -1 */
+int rng_kind(const char *name)
 {
-    if(!isNumber(optarg)) {
-        fprintf(stderr, "Invalid value for -%c\n", c);
-        exit(-1);
-    }
-    return atoi(optarg);
+    if (strcmp(name, "rand") == 0)
+        return RNG_RAND;
+    if (strcmp(name, "xoshiro") == 0)
+        return RNG_XOSHIRO;
+    if (strcmp(name, "pcg") == 0)
+        return RNG_PCG;
+    return -1;
 }
 
-float read_arg_float(char c)
+/* release everything the running simulation owns (whatever got set up) */
+/* and make outer the running simulation again                          */
+void simulation_end(struct simulation *outer)
 {
-    float val = atof(optarg);
-    if(val < 0.0 || val > 1.0){
-        fprintf(stderr, "Invalid value for -%c\n", c);
-        exit(-1);
-    }
-    return val;
+   int i;
+
+   trace_flush();
+   if (sim->evlog != NULL)
+      evlog_close(sim->evlog);
+   if (sim->protocol != NULL)
+      protocol_destroy(sim->protocol);
+   for (i=0; i<sim->evheap_size; i++)
+      freeevent(sim->evheap[i]);   /* payload blocks of packets still in flight */
+   for (i=0; i<sim->nevslabs; i++)
+      free(sim->evslabs[i]);
+   free(sim->evslabs);
+   free(sim->evheap);
+   free(sim->application_msgs[A]);
+   free(sim->application_msgs[B]);
+   free(sim->tracebuf);
+   free(sim);
+   sim = outer;
 }
 
-void display_usage(char *filename)
-{
-    printf("Usage:\n %s -s Seed -w Window size -m Number of messages to simulate -l Loss -c Corruption -t Average time between messages from sender's layer5 -v Tracing\n", filename);
-}
-
-int main(int argc, char **argv)
+/* run one simulation on the calling thread (see simulator.h) */
+int simulate(const struct sim_config *config, struct sim_report *report)
 {
+   struct simulation *outer = sim;
    struct event *eventptr;
    struct msg  msg2give;
    struct pkt  pkt2give;
+   int i,j,status;
 
-   int i,j;
-   char c;
-
-   int opt;
-   int seed;
-
-   //Check for number of arguments
-   if(argc != 15){
-           fprintf(stderr, "Missing arguments!\n");
-        display_usage(argv[0]);
-        return -1;
-   }
-
-   /*
-    * Parse the arguments
-    * http://www.gnu.org/software/libc/manual/html_node/Example-of-Getopt.html
-    */
-    while((opt = getopt(argc, argv,"s:w:m:l:c:t:v:")) != -1){
-        switch (opt){
-            case 's':   seed = read_arg_int(opt);
-                        break;
-            case 'w':   win_size = read_arg_int(opt);
-                        break;
-            case 'm':     nsimmax = read_arg_int(opt);
-                        break;
-            case 'l':     lossprob = read_arg_float(opt);
-                        break;
-            case 'c':     corruptprob = read_arg_float(opt);
-                        break;
-            case 't':     if((lambda = atof(optarg)) <= 0.0){
-                            fprintf(stderr, "Invalid value for -%c\n", opt);
-                            exit(-1);
-                        }
-                        break;
-            case 'v':     TRACE = read_arg_int(opt);
-                        break;
-            case '?':
-               default:    fprintf(stderr, "Invalid arguments!\n");
-                        display_usage(argv[0]);
-                        return -1;
-       }
-    }
-
-   init(seed);
+   if (config->msgsize < 1 || config->msgsize > PAYLOAD_MAX) {
+      fprintf(stderr, "Invalid msg size %d (1 to %d, see PAYLOAD_MAX)\n", config->msgsize, PAYLOAD_MAX);
+      return SIM_MSGSIZE_INVALID;   /* generated msgs would not fit in msg.data */
+      }
+   sim = (struct simulation *)calloc(1, sizeof(struct simulation));
+   if (sim == NULL) {
+      printf("INTERNAL PANIC: unable to allocate simulation\n");
+      exit(1);
+      }
+   sim->win_size = config->win_size;
+   sim->bidirectional = config->bidirectional;
+   sim->msgsize = config->msgsize;
+   sim->linkrate = config->linkrate;
+   sim->dupack_threshold = config->dupack_threshold;
+   sim->cwnd_mode = config->cwnd_mode;
+   sim->cwnd_trace_path = config->cwnd_trace_path;
+   sim->timeout = config->timeout;
+   sim->delayed_ack_count = config->delayed_ack_count;
+   sim->piggyback = config->piggyback;
+   sim->nsimmax = config->nsimmax;
+   sim->lossprob = config->lossprob;
+   sim->corruptprob = config->corruptprob;
+   sim->lambda = config->lambda;
+   sim->TRACE = config->trace;
+   sim->traceout = config->trace_file ? config->trace_file : stdout;
+
+   if (config->evlog_path != NULL) {
+      sim->evlog = evlog_create(config->evlog_path, EVLOG_CAPACITY);
+      if (sim->evlog == NULL) {
+         simulation_end(outer);
+         return SIM_EVLOG_FAILED;   /* evlog_create() said why */
+         }
+      }
+   hist_init(&sim->latency);
+   if ((status = init(config->seed, config->rng)) != 0) {
+      simulation_end(outer);
+      return status;           /* no usable random number generator */
+      }
+   sim->protocol = protocol_create();
    A_init();
    B_init();
 
    while (1) {
-        eventptr = evlist;            /* get next event to simulate */
+        eventptr = popevent();        /* get next event to simulate */
         if (eventptr==NULL)
-           goto terminate;
-        evlist = evlist->next;        /* remove this event from event list */
-        if (evlist!=NULL)
-           evlist->prev=NULL;
-        if (TRACE>=2) {
-           printf("\nEVENT time: %f,",eventptr->evtime);
-           printf("  type: %d",eventptr->evtype);
+           break;
+        if (TRACING(2)) {
+           tracef("\nEVENT time: %f,",eventptr->evtime);
+           tracef("  type: %d",eventptr->evtype);
            if (eventptr->evtype==0)
-           printf(", timerinterrupt  ");
+           tracef(", timerinterrupt  ");
              else if (eventptr->evtype==1)
-               printf(", fromlayer5 ");
+               tracef(", fromlayer5 ");
              else
-         printf(", fromlayer3 ");
-           printf(" entity: %d\n",eventptr->eventity);
+         tracef(", fromlayer3 ");
+           tracef(" entity: %d\n",eventptr->eventity);
            }
-        time_local = eventptr->evtime;        /* update time to next event time */
-        if (nsim==nsimmax)
+        sim->time_local = eventptr->evtime;        /* update time to next event time */
+        if (sim->nsim==sim->nsimmax) {
+           freeevent(eventptr);
       break;                        /* all done with simulation */
+           }
         if (eventptr->evtype == FROM_LAYER5 ) {
             generate_next_arrival();   /* set up future arrival */
             /* fill in msg to give with string of same letter */
-            j = nsim % 26;
-            for (i=0; i<20; i++)
-               msg2give.data[i] = 97 + j;
-            if (TRACE>2) {
-               printf("          MAINLOOP: data given to student: ");
-                 for (i=0; i<20; i++)
-                  printf("%c", msg2give.data[i]);
-               printf("\n");
+            j = sim->nsim % 26;
+            msg2give.length = sim->msgsize;
+            memset(msg2give.data, 97 + j, msg2give.length);
+            if (TRACING(3)) {
+               tracef("          MAINLOOP: data given to student: ");
+               trace_payload(msg2give.data, msg2give.length);
+               tracef("\n");
          }
-            nsim++;
+            sim->nsim++;
+            j = eventptr->eventity;
+            msg_track_reserve(j);
+            msg_track_slot(j, sim->cur_msg_sent[j])->fill = msg2give.data[0];
+            msg_track_slot(j, sim->cur_msg_sent[j])->length = msg2give.length;
+            msg_track_slot(j, sim->cur_msg_sent[j])->delivered = 0;
+            msg_track_slot(j, sim->cur_msg_sent[j])->created = sim->time_local;
+            logevent(EVLOG_APP, j, sim->cur_msg_sent[j], 0);
+            sim->cur_msg_sent[j] += 1;
             if (eventptr->eventity == A)
             {
-                A_application += 1;
-
-              memcpy(application_msgs[cur_msg_sent].msg_chars, msg2give.data, 20);
-              application_msgs[cur_msg_sent].delivered = 0;
-              cur_msg_sent += 1;
-
+                sim->A_application += 1;
               A_output(msg2give);
             }
-            /*
              else
+            {
+                sim->B_application_sent += 1;
                B_output(msg2give);
-               */
+            }
             }
           else if (eventptr->evtype ==  FROM_LAYER3) {
-            pkt2give.seqnum = eventptr->pktptr->seqnum;
-            pkt2give.acknum = eventptr->pktptr->acknum;
-            pkt2give.checksum = eventptr->pktptr->checksum;
-            for (i=0; i<20; i++)
-                pkt2give.payload[i] = eventptr->pktptr->payload[i];
+            pkt2give.seqnum = eventptr->evseqnum;
+            pkt2give.acknum = eventptr->evacknum;
+            pkt2give.checksum = eventptr->evchecksum;
+            pkt2give.length = eventptr->evlength;
+            memcpy(pkt2give.payload, eventptr->evpayload, eventptr->evpaylen);
+            logevent(EVLOG_ARRIVE, eventptr->eventity, pkt2give.seqnum, pkt2give.acknum);
         if (eventptr->eventity ==A)      /* deliver packet by calling */
-              A_input(pkt2give);            /* appropriate entity */
+            {                               /* appropriate entity */
+                sim->A_transport_recv += 1;
+                A_input(pkt2give);
+            }
             else
             {
-                B_transport += 1;
+                sim->B_transport += 1;
                 B_input(pkt2give);
             }
-        free(eventptr->pktptr);          /* free the memory for packet */
             }
           else if (eventptr->evtype ==  TIMER_INTERRUPT) {
+            sim->timerevent[eventptr->eventity] = NULL;   /* timer has fired */
+            logevent(EVLOG_TIMEOUT, eventptr->eventity, -1, -1);
             if (eventptr->eventity == A)
            A_timerinterrupt();
-               /*
              else
            B_timerinterrupt();
-               */
              }
           else  {
-         printf("INTERNAL PANIC: unknown event type \n");
+         tracef("INTERNAL PANIC: unknown event type \n");
              }
-        free(eventptr);
+        freeevent(eventptr);
+        if (sim->status != 0)
+           break;                    /* a delivery check failed */
         }
 
-terminate:
-   //Do NOT change any of the following printfs
-   printf(" Simulator terminated at time %f\n after sending %d msgs from layer5\n",time_local,nsim);
-
-   printf("\n");
-   printf("[PA2]%d packets sent from the Application Layer of Sender A[/PA2]\n", A_application);
-   printf("[PA2]%d packets sent from the Transport Layer of Sender A[/PA2]\n", A_transport);
-   printf("[PA2]%d packets received at the Transport layer of Receiver B[/PA2]\n", B_transport);
-   printf("[PA2]%d packets received at the Application layer of Receiver B[/PA2]\n", B_application);
-   printf("[PA2]Total time: %f time units[/PA2]\n", time_local);
-   printf("[PA2]Throughput: %f packets/time units[/PA2]\n", B_application/time_local);
-   return 0;
+   report->A_application = sim->A_application;
+   report->A_transport = sim->A_transport;
+   report->B_transport = sim->B_transport;
+   report->B_application = sim->B_application;
+   report->B_application_sent = sim->B_application_sent;
+   report->B_transport_sent = sim->B_transport_sent;
+   report->A_transport_recv = sim->A_transport_recv;
+   report->A_application_recv = sim->A_application_recv;
+   report->nsim = sim->nsim;
+   report->time_local = sim->time_local;
+   report->latency_mean = hist_mean(&sim->latency);
+   report->latency_p50 = hist_percentile(&sim->latency, 0.50);
+   report->latency_p99 = hist_percentile(&sim->latency, 0.99);
+   report->latency_p999 = hist_percentile(&sim->latency, 0.999);
+   report->latency_max = sim->latency.max;
+   status = sim->status;
+
+   simulation_end(outer);
+   return status;
 }
 
-
 /********************* EVENT HANDLINE ROUTINES *******/
 /*  The next set of routines handle the event list   */
 /*****************************************************/
@@ -437,8 +844,9 @@ void printevlist()
 {
   struct event *q;
   int i;
-  printf("--------------\nEvent List Follows:\n");
-  for(q = evlist; q!=NULL; q=q->next) {
+  printf("--------------\nEvent List Follows (heap order):\n");
+  for(i = 0; i < sim->evheap_size; i++) {
+    q = sim->evheap[i];
     printf("Event time: %f, type: %d entity: %d\n",q->evtime,q->evtype,q->eventity);
     }
   printf("--------------\n");
@@ -452,30 +860,20 @@ void printevlist()
 void stoptimer(int AorB)
  //AorB;  /* A or B is trying to stop timer */
 {
- struct event *q,*qold;
-
- if (TRACE>2)
-    printf("          STOP TIMER: stopping timer at %f\n",time_local);
-/* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
- for (q=evlist; q!=NULL ; q = q->next)
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) {
-       /* remove this event */
-       if (q->next==NULL && q->prev==NULL)
-             evlist=NULL;         /* remove first and only event on list */
-          else if (q->next==NULL) /* end of list - there is one in front */
-             q->prev->next = NULL;
-          else if (q==evlist) { /* front of list - there must be event after */
-             q->next->prev=NULL;
-             evlist = q->next;
-             }
-           else {     /* middle of list */
-             q->next->prev = q->prev;
-             q->prev->next =  q->next;
-             }
-       free(q);
-       return;
-     }
-  printf("Warning: unable to cancel your timer. It wasn't running.\n");
+ struct event *q;
+
+ if (TRACING(3))
+    tracef("          STOP TIMER: stopping timer at %f\n",sim->time_local);
+ q = sim->timerevent[AorB];
+ if (q != NULL) {
+    /* remove this event */
+    removeevent(q);
+    freeevent(q);
+    sim->timerevent[AorB] = NULL;
+    logevent(EVLOG_TIMER_STOP, AorB, -1, -1);
+    return;
+    }
+  tracef("Warning: unable to cancel your timer. It wasn't running.\n");
 }
 
 
@@ -484,147 +882,247 @@ void starttimer(int AorB,float increment)
 
 {
 
- struct event *q;
  struct event *evptr;
  ////char *malloc();
 
- if (TRACE>2)
-    printf("          START TIMER: starting timer at %f\n",time_local);
+ if (TRACING(3))
+    tracef("          START TIMER: starting timer at %f\n",sim->time_local);
  /* be nice: check to see if timer is already started, if so, then  warn */
-/* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-   for (q=evlist; q!=NULL ; q = q->next)
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) {
-      printf("Warning: attempt to start a timer that is already started\n");
+   if (sim->timerevent[AorB] != NULL) {
+      tracef("Warning: attempt to start a timer that is already started\n");
       return;
       }
 
 /* create future event for when timer goes off */
-   evptr = (struct event *)malloc(sizeof(struct event));
-   evptr->evtime =  time_local + increment;
+   evptr = allocevent();
+   evptr->evtime =  sim->time_local + increment;
    evptr->evtype =  TIMER_INTERRUPT;
    evptr->eventity = AorB;
    insertevent(evptr);
+   sim->timerevent[AorB] = evptr;
+   logevent(EVLOG_TIMER_START, AorB, -1, -1);
 }
 
 
 /************************** TOLAYER3 ***************/
-void tolayer3(int AorB,struct pkt packet)
+/* roll loss and corruption for one packet and schedule its arrival */
+void tolayer3_one(int AorB,const struct pkt *packet)
 {
- struct pkt *mypktptr;
- struct event *evptr,*q;
+ struct event *evptr;
  ////char *malloc();
  float lastime, x, jimsrand();
- int i;
+ int length = pkt_length(packet);
 
 
- ntolayer3++;
+ sim->ntolayer3++;
 
- if(AorB == 0) A_transport += 1;
+ if(AorB == 0) sim->A_transport += 1;
+ else sim->B_transport_sent += 1;
+ logevent(EVLOG_SEND, AorB, packet->seqnum, packet->acknum);
+
+ /* serialization: the frame (header and payload) goes out once the sender's */
+ /* link has sent the frames before it, whether or not the medium loses it  */
+ lastime = sim->time_local;
+ if (sim->linkrate > 0) {
+    if (sim->linkfree[AorB] > lastime)
+       lastime = sim->linkfree[AorB];
+    lastime += (PKT_HEADER_BYTES + length) / sim->linkrate;
+    sim->linkfree[AorB] = lastime;
+    }
 
  /* simulate losses: */
- if (jimsrand() < lossprob)  {
-      nlost++;
-      if (TRACE>0)
-    printf("          TOLAYER3: packet being lost\n");
+ if (jimsrand() < sim->lossprob)  {
+      sim->nlost++;
+      logevent(EVLOG_LOSS, AorB, packet->seqnum, packet->acknum);
+      if (TRACING(1))
+    tracef("          TOLAYER3: packet being lost\n");
       return;
     }
 
 /* make a copy of the packet student just gave me since he/she may decide */
-/* to do something with the packet after we return back to him/her */
- mypktptr = (struct pkt *)malloc(sizeof(struct pkt));
- mypktptr->seqnum = packet.seqnum;
- mypktptr->acknum = packet.acknum;
- mypktptr->checksum = packet.checksum;
- for (i=0; i<20; i++)
-    mypktptr->payload[i] = packet.payload[i];
- if (TRACE>2)  {
-   printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
-      mypktptr->acknum,  mypktptr->checksum);
-    for (i=0; i<20; i++)
-        printf("%c",mypktptr->payload[i]);
-    printf("\n");
+/* to do something with the packet after we return back to him/her. The   */
+/* copy lives inside the arrival event, so one allocation covers both     */
+/* (unless the payload is longer than EVINLINE).                          */
+ evptr = allocevent();
+ evptr->evseqnum = packet->seqnum;
+ evptr->evacknum = packet->acknum;
+ evptr->evchecksum = packet->checksum;
+ evptr->evlength = packet->length;
+ evptr->evpaylen = length;
+ evptr->evpayload = evptr->evinline;
+ if (length > EVINLINE)
+    evptr->evpayload = (char *)malloc(length);
+ if (evptr->evpayload == NULL) {
+    trace_flush();
+    printf("INTERNAL PANIC: unable to allocate packet payload\n");
+    exit(1);
+    }
+ memcpy(evptr->evpayload, packet->payload, length);
+ if (TRACING(3))  {
+   tracef("          TOLAYER3: seq: %d, ack %d, check: %d ", evptr->evseqnum,
+      evptr->evacknum,  evptr->evchecksum);
+    trace_payload(evptr->evpayload, length);
+    tracef("\n");
    }
 
 /* create future event for arrival of packet at the other side */
-  evptr = (struct event *)malloc(sizeof(struct event));
   evptr->evtype =  FROM_LAYER3;   /* packet will pop out from layer3 */
   evptr->eventity = (AorB+1) % 2; /* event occurs at other entity */
-  evptr->pktptr = mypktptr;       /* save ptr to my copy of packet */
 /* finally, compute the arrival time of packet at the other end.
    medium can not reorder, so make sure packet arrives between 1 and 10
    time units after the latest arrival time of packets
-   currently in the medium on their way to the destination */
- lastime = time_local;
-/* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next) */
- for (q=evlist; q!=NULL ; q = q->next)
-    if ( (q->evtype==FROM_LAYER3  && q->eventity==evptr->eventity) )
-      lastime = q->evtime;
+   currently in the medium on their way to the destination
+   (and after its last byte has left the sender, see above) */
+ if (sim->lastarrival[evptr->eventity] > lastime)
+    lastime = sim->lastarrival[evptr->eventity];
  evptr->evtime =  lastime + 1 + 9*jimsrand();
+ sim->lastarrival[evptr->eventity] = evptr->evtime;
 
 
 
  /* simulate corruption: */
- if (jimsrand() < corruptprob)  {
-    ncorrupt++;
-    if ( (x = jimsrand()) < .75)
-       mypktptr->payload[0]='Z';   /* corrupt payload */
+ if (jimsrand() < sim->corruptprob)  {
+    sim->ncorrupt++;
+    logevent(EVLOG_CORRUPT, AorB, packet->seqnum, packet->acknum);
+    if ( (x = jimsrand()) < .75) {
+       if (length > 0)
+          evptr->evpayload[0]='Z';    /* corrupt payload */
+         else
+          evptr->evlength = 999999;   /* no payload: corrupt its length */
+       }
       else if (x < .875)
-       mypktptr->seqnum = 999999;
+       evptr->evseqnum = 999999;
       else
-       mypktptr->acknum = 999999;
-    if (TRACE>0)
-    printf("          TOLAYER3: packet being corrupted\n");
+       evptr->evacknum = 999999;
+    if (TRACING(1))
+    tracef("          TOLAYER3: packet being corrupted\n");
     }
 
-  if (TRACE>2)
-     printf("          TOLAYER3: scheduling arrival on other side\n");
+  if (TRACING(3))
+     tracef("          TOLAYER3: scheduling arrival on other side\n");
   insertevent(evptr);
 }
 
-void tolayer5(int AorB,char *datasent)
+void tolayer3(int AorB,struct pkt packet)
+{
+  tolayer3_one(AorB, &packet);
+}
+
+/* pass n packets to layer 3 back to back, as n tolayer3() calls would */
+/* (same loss/corruption rolls, same arrival order), but with the events */
+/* for the whole burst reserved up front */
+void tolayer3_burst(int AorB,const struct pkt *packets,size_t n)
+{
+  size_t i;
+
+  evreserve((int)n);
+  for (i=0; i<n; i++)
+     tolayer3_one(AorB, &packets[i]);
+}
+
+void tolayer5(int AorB,char *datasent,int length)
 {
   int i;
-  if (TRACE>2) {
-     printf("          TOLAYER5: data received: ");
-     for (i=0; i<20; i++)
-        printf("%c",datasent[i]);
-     printf("\n");
+  int from = (AorB+1) % 2;   /* msgs delivered at one entity were sent by the other */
+  struct msg_track *expected;
+  if (TRACING(3)) {
+     tracef("          TOLAYER5: data received: ");
+     trace_payload(datasent, length);
+     tracef("\n");
    }
 
+   /* a failed check ends the simulation once the current event returns */
+   if (sim->status != 0)
+       return;
+
    /* Check for non-existent packet */
-   if (application_msgs[cur_msg_recv].msg_chars[0] == '\0') {
-       printf("PANIC: Unexpected/Non-existent packet!");
-       exit(52);
+   if (sim->cur_msg_recv[from] >= sim->cur_msg_sent[from]) {
+       tracef("PANIC: Unexpected/Non-existent packet!");
+       sim->status = 52;
+       return;
    }
 
   /* Check for out-of-order/duplicate packets */
-  if (strncmp(application_msgs[cur_msg_recv].msg_chars, datasent, 20) != 0){
-    printf("Expected: ");
-    for(int i=0; i<20; i+=1)
-      printf("%c", application_msgs[cur_msg_recv].msg_chars[i]);
-    printf("\nGot: ");
-    for(int i=0; i<20; i+=1)
-      printf("%c", datasent[i]);
-    exit(63);
+  expected = msg_track_slot(from, sim->cur_msg_recv[from]);
+  for (i=0; i<length && i<expected->length; i++)
+    if (datasent[i] != expected->fill)
+      break;
+  if (length != expected->length || i < length){
+    tracef("Expected: ");
+    for(i=0; i<expected->length && i<TRACE_PAYLOAD; i+=1)
+      tracef("%c", expected->fill);
+    if (expected->length > TRACE_PAYLOAD)
+      tracef("... (%d bytes)", expected->length);
+    tracef("\nGot: ");
+    trace_payload(datasent, length);
+    sim->status = 63;
+    return;
   }
 
-  if (cur_msg_recv != 0){
-    if (application_msgs[cur_msg_recv-1].delivered != 1)
-      exit(145);
+  if (sim->cur_msg_recv[from] != 0){
+    if (msg_track_slot(from, sim->cur_msg_recv[from]-1)->delivered != 1) {
+      sim->status = 145;
+      return;
+    }
   }
 
-  application_msgs[cur_msg_recv].delivered = 1; // Mark delivered
-  cur_msg_recv += 1;
+  msg_track_slot(from, sim->cur_msg_recv[from])->delivered = 1; // Mark delivered
+  hist_record(&sim->latency, sim->time_local - msg_track_slot(from, sim->cur_msg_recv[from])->created);
+  logevent(EVLOG_DELIVER, AorB, sim->cur_msg_recv[from], 0);
+  sim->cur_msg_recv[from] += 1;
 
-  if(AorB == 1) B_application += 1;
+  if(AorB == 1) sim->B_application += 1;
+    else sim->A_application_recv += 1;
 }
 
 int getwinsize()
 {
-    return win_size;
+    return sim->win_size;
+}
+
+int getbidirectional()
+{
+    return sim->bidirectional;
+}
+
+int getdupackthreshold()
+{
+    return sim->dupack_threshold;
+}
+
+int getdelayedackcount()
+{
+    return sim->delayed_ack_count;
+}
+
+int getpiggyback()
+{
+    return sim->piggyback;
+}
+
+int getcwndmode()
+{
+    return sim->cwnd_mode;
+}
+
+const char *getcwndtrace()
+{
+    return sim->cwnd_trace_path;
+}
+
+float gettimeout()
+{
+    return sim->timeout;
+}
+
+float getlinkdelay(int npkts)
+{
+    if (sim->linkrate <= 0)
+        return 0;
+    return npkts * (PKT_HEADER_BYTES + sim->msgsize) / sim->linkrate;
 }
 
 float get_sim_time()
 {
-    return time_local;
+    return sim->time_local;
 }
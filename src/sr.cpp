@@ -1,10 +1,12 @@
 #include "../include/simulator.h"
+#include "../include/rto.h"
+#include "../include/checksum.h"
+#include "../include/cwnd.h"
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
 #include <queue>
 #include <vector>
-#include <map>
 
 /* ******************************************************************
  ALTERNATING BIT AND GO-BACK-N NETWORK EMULATOR: VERSION 1.1  J.F.Kurose
@@ -24,181 +26,490 @@
 
 using namespace std;
 
-/* TIMEOUT_TIMEUNITS is constant for a set of expirements */
+/* TIMEOUT_TIMEUNITS is the initial timeout, until the first RTT is measured, */
+/* unless -T sets another one */
 #define TIMEOUT_TIMEUNITS 15.0 // 15.0, 20.0, 25.0, 30.0
 
-/* generic structure for entity (A/B) state */
-struct entity
-{
-    int seq; // sequence number -> alt bit protocol styles (usage values: 0,1) 
-    int ack; // acknowledgment number
-	int windowSize; // window size
-    int baseIndex; // base index of window
-};
-struct entity entity_A; // A
-struct entity entity_B; // B
+/* packet format: data packets carry seqnum >= 0 and, in acknum, the next */
+/* seq the sender expects from the peer (its piggybacked cumulative ACK).  */
+/* SACK format: seqnum = -1 - seq that triggered the SACK (so never a data */
+/* seqnum), acknum = cumulative next expected seq, payload = bitmap of     */
+/* seqs buffered above it, bit i set if acknum + 1 + i has been received   */
+/* (length = bytes of bitmap sent, enough for the window)                  */
+#define SACK_BITS (8 * (int)sizeof(((struct pkt *)0)->payload))
+
+/* delayed ACKs: B acknowledges every DELAYED_ACK_COUNT in-order packets, or */
+/* DELAYED_ACK_TIMEUNITS after the oldest unacknowledged one (1 disables),   */
+/* unless -A sets another count; out-of-order, duplicate and gap-filling     */
+/* packets are still ACKd at once                                            */
+#define DELAYED_ACK_COUNT 1
+#define DELAYED_ACK_TIMEUNITS 5.0
+
+/* piggybacked ACKs (bidirectional runs): 1 lets data packets carry the    */
+/* cumulative ACK of the peer's data, and holds in-order ACKs for outgoing */
+/* data to carry (sending one at least every PIGGYBACK_ACK_COUNT packets,  */
+/* or DELAYED_ACK_TIMEUNITS after the oldest); 0 sends every ACK on its own, */
+/* unless -P says otherwise                                                 */
+#define PIGGYBACK_ACKS 1
+#define PIGGYBACK_ACK_COUNT 2
 
 /* custom structure msgs with isAckd flag */
 struct buffer_msg
 {
-	char data[20];
+	struct msg message; // msg from layer5
 	bool isAckd;
+	float deadline; // expiry time of this seq's logical timer
+	float sentTime; // time of first transmission
+	bool isRetransmitted; // resent at least once (Karn's rule: no RTT sample)
 };
 /* custom structure for logical timers */
 struct seqtimers
 {
 	int seq; //seq num
-	float time; //time of creation
+	float time; //expiry time
 };
-
-// buffer to store incoming msgs from layer 5 for A
-vector<struct buffer_msg> messagesBufferA;
-// queue for logical seqtimers used by A
-queue<struct seqtimers> seqTimersQueueA;
-// map for packets in receiving window of B
-map<int, struct pkt> receivedPacketsMapB;
-
-/* helper method to compute checksum */
-/* INPUT: requires pointer to packet for which checksum is to be computed */
-/* OUTPUT: computed checksum */
-int get_checksum(struct pkt *packet)
-{
-    int localsum = 0;
-	int seqnum = packet->seqnum;
-	int acknum = packet->acknum;
-	int payloadsize = sizeof(packet->payload);
-
-    localsum += seqnum;
-    localsum += acknum;
-    for (int i = 0; i < payloadsize; i++) {
-		localsum += (packet->payload)[i];
+/* ordering for seqTimersHeap: earliest expiry (then lowest seq) on top */
+struct seqtimers_later
+{
+	bool operator()(const struct seqtimers &a, const struct seqtimers &b) const
+	{
+		if (a.time != b.time) return a.time > b.time;
+		return a.seq > b.seq;
 	}
-	// localsum = ~localsum; //bitswise NOT (optional logic)
-    return localsum;
+};
+
+/* generic structure for entity (A/B) state; each entity sends its own data */
+/* and receives the peer's */
+struct entity
+{
+	int id; // 0 for A, 1 for B (entity passed to the simulator routines)
+    int seq; // next seq to send
+    int ack; // acknowledgment number: next seq expected from the peer
+	int windowSize; // window size
+    int baseIndex; // base index of window
+	int pendingAcks; // in-order packets received but not yet acknowledged
+	float ackDeadline; // time the pending ACKs must be sent by
+	int delayedAckCount; // in-order packets acknowledged at once (1 never delays)
+	bool isPiggybacking; // data carries the ACK of the peer's data
+
+	// circular send window: seq s in [baseIndex, seq) lives in slot s % windowSize
+	vector<struct buffer_msg> messagesBuffer;
+	// msgs from layer 5 waiting for room in the send window
+	queue<struct msg> messagesBacklog;
+	// min-heap of logical seqtimers; entries go stale (and are skipped)
+	// once their seq is ackd or its timer is restarted with a new deadline
+	priority_queue<struct seqtimers, vector<struct seqtimers>, seqtimers_later> seqTimersHeap;
+	// packets sent during the current event, handed to layer3 as one burst
+	vector<struct pkt> packetsBurst;
+	// adaptive retransmission timeout
+	struct rto_estimator rto;
+	// congestion window
+	int cwndMode; // 1 limits the send window with slow start / AIMD (capped by -w), -W
+	struct cwnd_state cwnd;
+	// whether the hardware timer is running, and the logical expiry (seqtimer or
+	// pending ACKs) it was armed for
+	bool isTimerRunning;
+	float timerDeadline;
+
+	// reorder ring for packets in the receiving window: seq s lives in slot s % windowSize
+	vector<struct pkt> receivedPackets;
+	// bitmap of occupied slots in receivedPackets
+	vector<bool> isReceived;
+};
+
+/* protocol state of one simulation; made by protocol_create() and owned by the simulation */
+struct protocol_state
+{
+	struct entity entity_A; // A
+	struct entity entity_B; // B
+};
+// state of the simulation running on this thread
+thread_local struct protocol_state *state = NULL;
+
+/* called by the simulator before A_init() and B_init(): fresh state for one simulation */
+/* OUTPUT: the new state, which also becomes the state of the calling thread */
+struct protocol_state *protocol_create()
+{
+	state = new protocol_state();
+	return state;
+}
+
+/* called by the simulator once the simulation is over */
+/* INPUT: state returned by protocol_create() */
+void protocol_destroy(struct protocol_state *ended)
+{
+	cwnd_close(&ended->entity_A.cwnd);
+	cwnd_close(&ended->entity_B.cwnd);
+	if (state == ended) state = NULL;
+	delete ended;
+	return;
 }
 
 /* helper method to create data packet from message received from layer5 */
 /* INPUT: message from layer5, entity which requested (A or B) */
-/* OUTPUT: pointer to created packet */
-struct pkt *create_data_packet(struct buffer_msg message, struct entity host, int seqnum)
-{
-    struct pkt *packet = new struct pkt;
-    packet->seqnum = seqnum;
-    packet->acknum = host.ack;
-    strcpy(packet->payload, message.data);
-    packet->checksum = get_checksum(packet);
+/* OUTPUT: created packet (by value, nothing to free) */
+struct pkt create_data_packet(const struct buffer_msg &message, const struct entity *host, int seqnum)
+{
+    struct pkt packet;
+    packet.seqnum = seqnum;
+    packet.acknum = host->ack; // piggybacked cumulative ACK of the peer's data
+    packet.length = message.message.length;
+    memcpy(packet.payload, message.message.data, message.message.length); // data is not NUL-terminated
+    packet.checksum = get_checksum(&packet);
     return packet;
 }
 
-/* helper method to create ACK / NAK packets */
-/* INPUT: ack/nak number */
-/* OUTPUT: pointer to created packet */
-struct pkt *create_ack_packet(int ack_number)
+/* helper method to create selective ACK packets from an entity's receive state */
+/* INPUT: receiving entity, seq num of the packet being acknowledged */
+/* OUTPUT: created packet (by value, nothing to free) */
+struct pkt create_sack_packet(const struct entity *host, int seq_number)
 {
-    struct pkt *packet = new struct pkt;
-    packet->acknum = ack_number;
-    packet->checksum = get_checksum(packet);
+    struct pkt packet;
+    int bits = host->windowSize - 1 < SACK_BITS ? host->windowSize - 1 : SACK_BITS;
+    packet.seqnum = -1 - seq_number;
+    packet.acknum = host->ack;
+    packet.length = (bits + 7) / 8; // only the bitmap is sent
+    memset(packet.payload, 0, packet.length);
+    for (int i = 0; i < bits; i++) {
+        if (host->isReceived[(host->ack + 1 + i) % host->windowSize]) {
+            packet.payload[i / 8] |= 1 << (i % 8);
+        }
+    }
+    packet.checksum = get_checksum(&packet);
     return packet;
 }
 
 /* helper method to create custom buffer_msg struct with original msg data and a isAckd flag  */
 /* INPUT: struct msg message */
-/* OUTPUT: pointer to created buffer_msg */
-struct buffer_msg *create_buffer_msg(struct msg message)
+/* OUTPUT: created buffer_msg (by value, nothing to free) */
+struct buffer_msg create_buffer_msg(struct msg message)
 {
-	struct buffer_msg *newMsg = new struct buffer_msg;
-	newMsg->isAckd = false;
-	strncpy(newMsg->data, message.data, sizeof(message.data));
+	struct buffer_msg newMsg;
+	newMsg.isAckd = false;
+	newMsg.isRetransmitted = false;
+	newMsg.message = message;
     return newMsg;
 }
 
-/* helper method to hanlde logical seq timers */
-void util_A_handle_logical_seqtimers()
+/* helper method to access the send window slot of a seq */
+/* INPUT: sending entity, seq num in [baseIndex, seq) */
+/* OUTPUT: reference to the buffer_msg of that seq */
+struct buffer_msg &util_window_slot(struct entity *host, int seq)
 {
-    while (seqTimersQueueA.size() > 0 && seqTimersQueueA.size() <= entity_A.windowSize && messagesBufferA[seqTimersQueueA.front().seq].isAckd == true) {
-        seqTimersQueueA.pop(); // clear corresponding seqTimers for ackd packets from queue
-    }
-    if (seqTimersQueueA.size() > 0 && seqTimersQueueA.size() <= entity_A.windowSize) {
-        // start global timer if there are still logical timers to be handled
-        starttimer(0, TIMEOUT_TIMEUNITS);
-    }
+	return host->messagesBuffer[seq % host->windowSize];
+}
+
+/* helper method to check whether a sent seq has been ackd */
+/* (seqs below baseIndex have slid out of the window and their slots may be reused) */
+bool util_is_ackd(struct entity *host, int seq)
+{
+	return seq < host->baseIndex || util_window_slot(host, seq).isAckd;
+}
+
+/* helper method to check whether a logical seqtimer is still pending */
+bool util_is_live_seqtimer(struct entity *host, const struct seqtimers &seqTimer)
+{
+	return !util_is_ackd(host, seqTimer.seq) && util_window_slot(host, seqTimer.seq).deadline == seqTimer.time;
+}
+
+/* helper method to point the hardware timer at the earliest pending logical seqtimer */
+/* or the deadline of pending ACKs, whichever comes first */
+/* (armed with the exact time remaining, not a fresh TIMEOUT_TIMEUNITS) */
+void util_handle_logical_seqtimers(struct entity *host)
+{
+	while (!host->seqTimersHeap.empty() && !util_is_live_seqtimer(host, host->seqTimersHeap.top())) {
+		host->seqTimersHeap.pop(); // clear stale seqTimers of ackd or restarted packets
+	}
+	if (host->seqTimersHeap.empty() && host->pendingAcks == 0) {
+		if (host->isTimerRunning) stoptimer(host->id);
+		host->isTimerRunning = false;
+		return;
+	}
+	float deadline = host->seqTimersHeap.empty() ? host->ackDeadline : host->seqTimersHeap.top().time;
+	if (host->pendingAcks > 0 && host->ackDeadline < deadline) deadline = host->ackDeadline;
+	if (host->isTimerRunning && host->timerDeadline == deadline) {
+		return; // already armed for this expiry
+	}
+	if (host->isTimerRunning) stoptimer(host->id);
+	starttimer(host->id, deadline - get_sim_time());
+	host->isTimerRunning = true;
+	host->timerDeadline = deadline;
 	return;
 }
 
-/* helper method to access messagesBuffer and pass packets to layer3 */
-/* INPUT: bool isInterrupt, int seq_num; seq_num to be passed along if isInterrupt */
-void util_A_send_packets(bool isInterrupt, int seq_num)
+/* helper method to get the number of seqs an entity may have in flight from baseIndex */
+/* (expired packets are always retransmitted; this only gates new seqs) */
+int util_send_window(struct entity *host)
+{
+	return host->cwndMode ? cwnd_get(&host->cwnd) : host->windowSize;
+}
+
+/* helper method to get the number of in-order packets acknowledged at once */
+int util_ack_count(const struct entity *host)
+{
+	if (host->isPiggybacking && getbidirectional() && host->delayedAckCount < PIGGYBACK_ACK_COUNT) {
+		return PIGGYBACK_ACK_COUNT; // give outgoing data the chance to carry the ACK
+	}
+	return host->delayedAckCount;
+}
+
+/* helper method to access messagesBuffer and queue packets for layer3 */
+/* (sent by util_flush_packets) */
+/* INPUT: sending entity, bool isInterrupt, int seq_num; seq_num to be passed along if isInterrupt */
+void util_send_packets(struct entity *host, bool isInterrupt, int seq_num)
 {
 	// if isInterrupt == true; use seq number passed with interrupt flag
-	int localSeq = isInterrupt ? seq_num : entity_A.seq;
-	if (!(localSeq >= entity_A.baseIndex && localSeq < entity_A.baseIndex + entity_A.windowSize)) {
+	int localSeq = isInterrupt ? seq_num : host->seq;
+	if (!(localSeq >= host->baseIndex && localSeq < host->baseIndex + host->windowSize)) {
 		return; // do nothing and return if seq is out of sending window
 	}
 
-	// if seq is within sending window, create packet and pass to layer 3
-	struct buffer_msg currMsg = messagesBufferA[localSeq];
-	struct pkt *packet = create_data_packet(currMsg, entity_A, localSeq);
-	tolayer3(0, *packet);
+	if (!isInterrupt) {
+		if (host->messagesBacklog.empty() || localSeq >= host->baseIndex + util_send_window(host)) {
+			return; // nothing waiting to enter the window, or no room under cwnd
+		}
+		// move next waiting msg into its window slot
+		util_window_slot(host, localSeq) = create_buffer_msg(host->messagesBacklog.front());
+		util_window_slot(host, localSeq).sentTime = get_sim_time();
+		host->messagesBacklog.pop();
+	} else {
+		util_window_slot(host, localSeq).isRetransmitted = true;
+	}
 
-	if (!isInterrupt) entity_A.seq++; // increment seq num if not interrupt retrasnmit
-	if (seqTimersQueueA.size() == 0) starttimer(0, TIMEOUT_TIMEUNITS); //  start global timer
+	// if seq is within sending window, create packet and queue it for layer 3
+	host->packetsBurst.push_back(create_data_packet(util_window_slot(host, localSeq), host, localSeq));
 
-	// create and push new logical seqTimer to queue
+	if (!isInterrupt) host->seq++; // increment seq num if not interrupt retrasnmit
+
+	// (re)start the logical seqTimer of this seq
 	struct seqtimers seqTimer;
 	seqTimer.seq = localSeq;
-	seqTimer.time = get_sim_time();
-	seqTimersQueueA.push(seqTimer);
+	seqTimer.time = get_sim_time() + rto_get(&host->rto);
+	util_window_slot(host, localSeq).deadline = seqTimer.time;
+	host->seqTimersHeap.push(seqTimer);
 	return;
 }
 
-/* called from layer 5, passed the data to be sent to other side */
-void A_output(struct msg message)
+/* helper method to pass the queued packets to layer3 as one burst */
+/* and arm the hardware timer for the earliest pending seqtimer */
+/* OUTPUT: number of packets sent */
+int util_flush_packets(struct entity *host)
 {
-	// create new buffer_msg time and add to buffer
-	struct buffer_msg *newMsg = create_buffer_msg(message);
-	messagesBufferA.push_back(*newMsg);
-	// call utility function to check, process and send data if possible
-	util_A_send_packets(false, 0);
+	int sent = (int)host->packetsBurst.size();
+	if (sent > 0) {
+		tolayer3_burst(host->id, host->packetsBurst.data(), host->packetsBurst.size());
+		host->packetsBurst.clear();
+		if (host->isPiggybacking) host->pendingAcks = 0; // the data carried the cumulative ACK
+	}
+	util_handle_logical_seqtimers(host);
+	return sent;
+}
+
+/* helper method to mark a sent seq as ackd (ignores seqs outside the window) */
+void util_mark_ackd(struct entity *host, int seq)
+{
+	if (seq < host->baseIndex || seq >= host->seq) {
+		return;
+	}
+	struct buffer_msg &ackdMsg = util_window_slot(host, seq);
+	if (!ackdMsg.isAckd) {
+		// new data ackd
+		// keep the backoff until a pkt sent once is ackd: when spurious resends
+		// clog the medium every ACK is of a resent pkt and, by Karn's rule, none
+		// gives a sample, so clearing it on those would keep the cascade going
+		if (!ackdMsg.isRetransmitted) rto_ack(&host->rto);
+		if (host->cwndMode) cwnd_on_ack(&host->cwnd, 1);
+	}
+	ackdMsg.isAckd = true; // set isAckd flag as true for corresponding msg
 	return;
 }
 
-/* called from layer 3, when a packet arrives for layer 4 */
-void A_input(struct pkt packet)
+/* helper method for an entity to act on the peer's SACK, or on the */
+/* cumulative ACK piggybacked on the peer's data */
+/* INPUT: receiving entity, packet, isPure (a SACK, not a data packet) */
+/* OUTPUT: number of packets sent in reply */
+int util_ack_received(struct entity *host, const struct pkt *packet, bool isPure)
 {
-	if (packet.checksum != get_checksum(&packet)) {
-		return; // return if packet is NOT valid
+	if (isPure) {
+		// only the packet that triggered this SACK gives an unambiguous RTT sample
+		int ackdSeq = -1 - packet->seqnum;
+		if (ackdSeq >= host->baseIndex && ackdSeq < host->seq) {
+			struct buffer_msg &ackdMsg = util_window_slot(host, ackdSeq);
+			if (!ackdMsg.isAckd && !ackdMsg.isRetransmitted) {
+				rto_sample(&host->rto, get_sim_time() - ackdMsg.sentTime);
+			}
+		}
+		util_mark_ackd(host, ackdSeq);
+	}
+	// cumulative part: everything below acknum has been received by the peer
+	for (int s = host->baseIndex; s < packet->acknum && s < host->seq; s++) {
+		util_mark_ackd(host, s);
 	}
-	int ack = packet.acknum;
-	messagesBufferA[ack].isAckd = true; // set isAckd flag as true for corresponding msg
-	if (ack == entity_A.baseIndex) {
-    	// stoptimer(0);
-		// loop to increment and move baseIndex to next unacked packet
-		for (; entity_A.baseIndex < messagesBufferA.size() && messagesBufferA[entity_A.baseIndex].isAckd == true; entity_A.baseIndex++) {
-			// seqTimersQueueA.pop(); // clear corresponding seqTimers from queue
+	// selective part: seqs buffered at the peer above acknum
+	for (int i = 0; isPure && i < 8 * packet->length && i < SACK_BITS; i++) {
+		if (packet->payload[i / 8] & (1 << (i % 8))) {
+			util_mark_ackd(host, packet->acknum + 1 + i);
 		}
-		// since packets have been ackd and baseIndex incremented, check if A is ready to send more msgs in the window range  
-		while ((entity_A.seq < entity_A.baseIndex + entity_A.windowSize && entity_A.seq < messagesBufferA.size())) {
-			util_A_send_packets(false, 0);
+	}
+	// loop to increment and move baseIndex to next unacked packet
+	for (; host->baseIndex < host->seq && util_window_slot(host, host->baseIndex).isAckd == true; host->baseIndex++) {
+	}
+	// since packets have been ackd and baseIndex incremented, check if the entity is ready to send more msgs in the window range  
+	while ((host->seq < host->baseIndex + util_send_window(host) && !host->messagesBacklog.empty())) {
+		util_send_packets(host, false, 0);
+	}
+	// send the refill, then rearm for the next pending seqtimer
+	// (the ackd seqs' logical timers are now stale)
+	return util_flush_packets(host);
+}
+
+/* helper method for an entity to send a SACK; it reports all of its receive */
+/* state, so it also covers, and clears, any delayed ACKs */
+/* (the caller rearms the hardware timer) */
+/* INPUT: receiving entity, seq num of the packet being acknowledged */
+void util_send_sack(struct entity *host, int seq_number)
+{
+    struct pkt ack_packet = create_sack_packet(host, seq_number);
+    tolayer3(host->id, ack_packet);
+    host->pendingAcks = 0;
+	return;
+}
+
+/* helper method for an entity to take in a valid data packet from the peer */
+void util_data_received(struct entity *host, struct pkt *packet)
+{
+    bool canDelayAck = false;
+    // if received packet seq is in receiving window
+	if (packet->seqnum >= host->ack && packet->seqnum < host->ack + host->windowSize) {
+		
+		if (packet->seqnum == host->ack) {
+            // if received packet seq is base expected seq, pass to layer5
+			tolayer5(host->id, packet->payload, packet->length);
+			host->ack++;
+			// drain buffered packets while the next expected seq is present and pass to layer5
+			int slot = host->ack % host->windowSize;
+			canDelayAck = !host->isReceived[slot]; // plain in-order arrival, no gap filled
+			while (host->isReceived[slot]) {
+				tolayer5(host->id, host->receivedPackets[slot].payload, host->receivedPackets[slot].length);
+				host->isReceived[slot] = false;
+				host->ack++;
+				slot = host->ack % host->windowSize;
+			}
+		} else {
+			// else if received packet seq is not base expected seq, buffer it to consume later
+			int slot = packet->seqnum % host->windowSize;
+			host->receivedPackets[slot] = *packet;
+			host->isReceived[slot] = true;
 		}
+    }
+    // the ACK this packet carries may slide the window; the data sent then carries ours
+    if (host->isPiggybacking && util_ack_received(host, packet, false) > 0 && canDelayAck) {
+        return; // acknowledged by piggybacked data
+    }
+    if (canDelayAck && host->pendingAcks++ == 0) {
+        host->ackDeadline = get_sim_time() + DELAYED_ACK_TIMEUNITS; // bound the delay of this ACK
+    }
+    if (!canDelayAck || host->pendingAcks >= util_ack_count(host)) {
+        // send ack back if packet is valid, reporting the receive state after this packet
+        util_send_sack(host, packet->seqnum);
+    }
+    util_handle_logical_seqtimers(host);
+	return;
+}
+
+/* helper method for an entity to take in a packet from layer3 */
+void util_input(struct entity *host, struct pkt *packet)
+{
+	if (packet->checksum != get_checksum(packet)) {
+		return; // return if packet is NOT valid
+	}
+	if (packet->seqnum < 0) {
+		util_ack_received(host, packet, true);
+	} else {
+		util_data_received(host, packet);
+	}
+	return;
+}
+
+/* helper method for an entity's timer interrupt */
+void util_timerinterrupt(struct entity *host)
+{
+	host->isTimerRunning = false;
+	// resend every seq whose logical timer expired at the armed deadline
+	// (retransmits push fresh seqtimers, so remember which deadline fired)
+	float expired = host->timerDeadline;
+	if (host->pendingAcks > 0 && host->ackDeadline <= expired) {
+		// flush delayed ACKs
+		util_send_sack(host, host->ack - 1);
 	}
-	if (ack == seqTimersQueueA.front().seq) {
-    	stoptimer(0);
-        seqTimersQueueA.pop();
-        // clear corresponding seqTimers from queue for ackd packets
-        util_A_handle_logical_seqtimers();
+	bool isBackedOff = false;
+	while (!host->seqTimersHeap.empty() && host->seqTimersHeap.top().time <= expired) {
+		struct seqtimers seqTimer = host->seqTimersHeap.top();
+		host->seqTimersHeap.pop();
+		if (util_is_live_seqtimer(host, seqTimer)) {
+			if (!isBackedOff) {
+				rto_backoff(&host->rto);
+				if (host->cwndMode) cwnd_on_timeout(&host->cwnd);
+				isBackedOff = true;
+			}
+			util_send_packets(host, true, seqTimer.seq);
+		}
 	}
+	util_flush_packets(host);
+	return;
+}
+
+/* helper method to initialize the state of an entity */
+/* INPUT: entity, its id (0 for A, 1 for B), file for its cwnd trajectory (or NULL) */
+void util_init(struct entity *host, int id, const char *cwndTraceFile)
+{
+	host->id = id;
+	host->seq = 0;
+	host->ack = 0;
+	host->baseIndex = 0;
+	host->windowSize = getwinsize();
+	host->pendingAcks = 0;
+	host->delayedAckCount = getdelayedackcount() < 0 ? DELAYED_ACK_COUNT : getdelayedackcount();
+	host->isPiggybacking = getpiggyback() < 0 ? PIGGYBACK_ACKS : getpiggyback();
+	host->messagesBuffer.resize(host->windowSize);
+	host->packetsBurst.reserve(host->windowSize);
+	host->isTimerRunning = false;
+	host->timerDeadline = 0;
+	// the last pkt of a full window queues behind the rest on a rate limited link;
+	// a spurious resend delays the pkts behind it and can time them out as well,
+	// so never time out sooner than the tuned timeout, whatever the queueing delay
+	float timeout = gettimeout() > 0 ? gettimeout() : TIMEOUT_TIMEUNITS;
+	rto_init(&host->rto, timeout, timeout, RTO_MAX, getlinkdelay(host->windowSize));
+	host->cwndMode = getcwndmode();
+	// the window only moves, and its trajectory is only written, in cwnd mode
+	cwnd_init(&host->cwnd, host->windowSize, host->cwndMode ? cwndTraceFile : NULL);
+	host->receivedPackets.resize(host->windowSize);
+	host->isReceived.assign(host->windowSize, false);
+	return;
+}
+
+/* called from layer 5, passed the data to be sent to other side */
+void A_output(struct msg message)
+{
+	// queue msg until it can enter the send window
+	state->entity_A.messagesBacklog.push(message);
+	// call utility function to check, process and send data if possible
+	util_send_packets(&state->entity_A, false, 0);
+	util_flush_packets(&state->entity_A);
+	return;
+}
+
+/* called from layer 3, when a packet arrives for layer 4 */
+void A_input(struct pkt packet)
+{
+	util_input(&state->entity_A, &packet);
 	return;
 }
 
 /* called when A's timer goes off */
 void A_timerinterrupt()
 {
-	// resend interrupted seq
-    int seqToResend = seqTimersQueueA.front().seq;
-    seqTimersQueueA.pop();
-    util_A_handle_logical_seqtimers();
-    util_A_send_packets(true, seqToResend);
-    //
+	util_timerinterrupt(&state->entity_A);
 	return;
 }
 
@@ -206,47 +517,30 @@ void A_timerinterrupt()
 /* entity A routines are called. You can use it to do any initialization */
 void A_init()
 {
-	// initialiaze state of entity_A
-	entity_A.seq = 0;
-	entity_A.ack = 0;
-	entity_A.baseIndex = 0;
-	entity_A.windowSize = getwinsize();
+	util_init(&state->entity_A, 0, getcwndtrace());
 	return;
 }
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
+/* called from layer 5 at B (bidirectional runs only), passed the data to be sent to A */
+void B_output(struct msg message)
+{
+	state->entity_B.messagesBacklog.push(message);
+	util_send_packets(&state->entity_B, false, 0);
+	util_flush_packets(&state->entity_B);
+	return;
+}
 
 /* called from layer 3, when a packet arrives for layer 4 at B*/
 void B_input(struct pkt packet)
 {
-    if (packet.checksum != get_checksum(&packet)) {
-		return; // return if packet is NOT valid
-	}
-    // send ack back if packet is valid
-    struct pkt *ack_packet = create_ack_packet(packet.seqnum);
-    tolayer3(1, *ack_packet);
+	util_input(&state->entity_B, &packet);
+	return;
+}
 
-    // if received packet seq is in receiving window
-	if (packet.seqnum >= entity_B.ack && packet.seqnum < entity_B.ack + entity_B.windowSize) {
-		
-		if (packet.seqnum == entity_B.ack) {
-            // if received packet seq is base expected seq, pass to layer5
-			tolayer5(1, packet.payload);
-			entity_B.ack++;
-			// check map recursively if next expected seq packet is present and pass to layer5
-			map<int, struct pkt>::iterator iter;
-			iter = receivedPacketsMapB.find(entity_B.ack);
-			while (iter != receivedPacketsMapB.end()) {
-				tolayer5(1, iter->second.payload);
-				receivedPacketsMapB.erase(iter);
-				entity_B.ack++;
-				iter = receivedPacketsMapB.find(entity_B.ack);
-			}
-		} else {
-			// else if received packet seq is base expected seq, add to received map to consume later
-			receivedPacketsMapB[packet.seqnum] = packet;
-		}
-    }
+/* called when B's timer goes off */
+void B_timerinterrupt()
+{
+	util_timerinterrupt(&state->entity_B);
 	return;
 }
 
@@ -254,10 +548,6 @@ void B_input(struct pkt packet)
 /* entity B routines are called. You can use it to do any initialization */
 void B_init()
 {
-	// initialiaze state of entity_B
-	entity_B.seq = 0; // unused as B is not transmitting app layer data to A
-	entity_B.ack = 0;
-	entity_B.baseIndex = 0;
-	entity_B.windowSize = getwinsize();
+	util_init(&state->entity_B, 1, NULL);
 	return;
 }
@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/simulator.h"
+
+/* ******************************************************************
+ Parameter sweep driver, built once per protocol (sweep_abt, sweep_gbn,
+ sweep_sr) since each protocol defines the same A_ and B_ routines.
+
+   Every option takes a comma separated list (integer options also take
+   lo:hi ranges); the cross product of all lists is run on -j worker
+   threads that pull the next point off a shared cursor and run it
+   in-process with simulate(), each simulation on its own thread state.
+   One CSV row per run is written to stdout in grid order, with the
+   [PA2] report and latency/overhead figures of the run; -b 0,1 runs
+   each point unidirectional (0) and bidirectional (1), the latter adding
+   the reverse and total transport traffic; -z and -k set the msg size in
+   bytes (up to the PAYLOAD_MAX of the build) and the link rate (0: no
+   serialization delay), -D the GBN duplicate ACK threshold (-1: the
+   protocol's default), -W the congestion window mode (0: full window,
+   1: slow start / AIMD), -T the initial retransmission timeout (0: the
+   protocol's default), -A the in-order packets GBN and SR acknowledge at
+   once (1: no delayed ACKs), -P whether they piggyback ACKs on data in
+   bidirectional runs (0: off, 1: on). Trace warnings go to stderr.
+
+   usage: sweep_gbn -s 1:10 -w 10,50 -m 1000 -l 0.0,0.2 -c 0.0,0.2
+                    -t 20,50 [-r rand,xoshiro,pcg] [-b 0,1] [-z 10,20]
+                    [-k 0,100] [-D 0,3] [-W 0,1]
+                    [-T 0,10,30] [-A 1,2] [-P 0,1] [-j workers]
+**********************************************************************/
+
+using namespace std;
+
+#ifndef SWEEP_PROTOCOL
+#define SWEEP_PROTOCOL "unknown" // set by the Makefile to the protocol linked in
+#endif
+
+/* one grid point and the [PA2] report of its run */
+struct sweep_run
+{
+	int seed, window, messages;
+	double loss, corrupt, interval;
+	string rng;
+	int bidirectional;
+	int msgsize;
+	double linkrate;
+	int dupack;
+	int cwndmode;
+	double timeout;
+	int delayedack;
+	int piggyback;
+	int a_application, a_transport, b_transport, b_application;
+	double total_time, throughput;
+	double latency_mean, latency_p50, latency_p99, latency_p999, latency_max;
+	double overhead; // transport packets per application packet at A
+	double goodput; // payload bytes delivered at B per time unit
+	int b_application_sent, a_application_recv, b_transport_sent; // bidirectional runs only
+	double per_delivered; // transport packets of A and B per delivered packet (bidirectional)
+	int status; // simulate() status, -1 if it did not run
+	bool done;
+};
+
+vector<int> seeds, windows, messageCounts, directions, msgsizes, dupacks, cwndmodes, delayedacks, piggybacks;
+vector<double> losses, corrupts, intervals, linkrates, timeouts;
+vector<string> rngs;
+
+vector<struct sweep_run> runs;
+atomic<size_t> nextRun(0); // next grid point to be claimed by a worker
+mutex outputLock; // guards done flags and nextPrint
+size_t nextPrint = 0; // first run whose row has not been written yet
+
+void display_usage(char *filename)
+{
+	fprintf(stderr, "Usage:\n %s -s Seeds -w Window sizes -m Numbers of messages -l Losses -c Corruptions -t Average times between messages [-r Random number generators] [-b Bidirectional (0 or 1)] [-z Message sizes] [-k Link rates] [-D Duplicate ACK thresholds] [-W Congestion window modes (0 or 1)] [-T Initial timeouts] [-A Delayed ACK counts] [-P Piggybacked ACKs (0 or 1)] [-j Workers]\n", filename);
+	fprintf(stderr, " lists are comma separated, integer lists also take lo:hi ranges\n");
+}
+
+/* helper method to reject an option value; returns the exit status */
+int invalid_value(char opt)
+{
+	fprintf(stderr, "Invalid value for -%c\n", opt);
+	return -1;
+}
+
+/* helper method to split a comma separated option into its items */
+vector<string> split_list(const char *arg)
+{
+	vector<string> items;
+	string item;
+	for (const char *p = arg; ; p++) {
+		if (*p == ',' || *p == '\0') {
+			if (!item.empty()) items.push_back(item);
+			item.clear();
+			if (*p == '\0') break;
+		} else {
+			item += *p;
+		}
+	}
+	return items;
+}
+
+/* helper method to parse an integer list (items may be lo:hi ranges) */
+vector<int> parse_int_list(char opt, const char *arg)
+{
+	vector<int> values;
+	vector<string> items = split_list(arg);
+	for (size_t i = 0; i < items.size(); i++) {
+		char *end;
+		long lo = strtol(items[i].c_str(), &end, 10), hi = lo;
+		if (*end == ':') hi = strtol(end + 1, &end, 10);
+		if (*end != '\0' || lo < 0 || hi < lo) {
+			fprintf(stderr, "Invalid value for -%c\n", opt);
+			exit(-1);
+		}
+		for (long v = lo; v <= hi; v++) values.push_back((int)v);
+	}
+	return values;
+}
+
+/* helper method to parse a list of probabilities / times */
+vector<double> parse_float_list(char opt, const char *arg)
+{
+	vector<double> values;
+	vector<string> items = split_list(arg);
+	for (size_t i = 0; i < items.size(); i++) {
+		char *end;
+		double v = strtod(items[i].c_str(), &end);
+		if (*end != '\0' || v < 0.0) {
+			fprintf(stderr, "Invalid value for -%c\n", opt);
+			exit(-1);
+		}
+		values.push_back(v);
+	}
+	return values;
+}
+
+/* helper method to run one simulation on the calling thread and keep its report */
+void run_simulation(struct sweep_run *run)
+{
+	struct sim_config config;
+	struct sim_report report;
+
+	config.seed = run->seed;
+	config.rng = rng_kind(run->rng.c_str());
+	config.win_size = run->window;
+	config.nsimmax = run->messages;
+	config.lossprob = run->loss;
+	config.corruptprob = run->corrupt;
+	config.lambda = run->interval;
+	config.trace = 0;
+	config.trace_file = stderr;
+	config.evlog_path = NULL;
+	config.bidirectional = run->bidirectional;
+	config.msgsize = run->msgsize;
+	config.linkrate = run->linkrate;
+	config.dupack_threshold = run->dupack;
+	config.cwnd_mode = run->cwndmode;
+	config.cwnd_trace_path = NULL;
+	config.timeout = run->timeout;
+	config.delayed_ack_count = run->delayedack;
+	config.piggyback = run->piggyback;
+	run->status = simulate(&config, &report);
+	if (run->status != 0) return; // no report, as the simulators print none
+	// the figures the simulators print, computed the same way
+	run->a_application = report.A_application;
+	run->a_transport = report.A_transport;
+	run->b_transport = report.B_transport;
+	run->b_application = report.B_application;
+	run->total_time = report.time_local;
+	run->throughput = report.B_application/report.time_local;
+	run->latency_mean = report.latency_mean;
+	run->latency_p50 = report.latency_p50;
+	run->latency_p99 = report.latency_p99;
+	run->latency_p999 = report.latency_p999;
+	run->latency_max = report.latency_max;
+	run->overhead = report.A_application ? (float)report.A_transport/report.A_application : 0.0f;
+	run->goodput = (float)report.B_application*config.msgsize/report.time_local;
+	if (run->bidirectional) {
+		int delivered = report.B_application + report.A_application_recv;
+		run->b_application_sent = report.B_application_sent;
+		run->a_application_recv = report.A_application_recv;
+		run->b_transport_sent = report.B_transport_sent;
+		run->per_delivered = delivered ? (float)(report.A_transport + report.B_transport_sent)/delivered : 0.0f;
+	}
+	return;
+}
+
+/* helper method to write the CSV rows of all finished runs that are next in grid order */
+/* (caller holds outputLock) */
+void print_finished_runs()
+{
+	for (; nextPrint < runs.size() && runs[nextPrint].done; nextPrint++) {
+		const struct sweep_run &run = runs[nextPrint];
+		printf("%s,%d,%d,%d,%g,%g,%g,%s,%d,%d,%g,%d,%d,%g,%d,%d,%d,%d,%d,%d,%f,%f,%f,%f,%f,%f,%f,%f,%f,%d,%d,%d,%f,%d\n",
+		       SWEEP_PROTOCOL, run.seed, run.window, run.messages,
+		       run.loss, run.corrupt, run.interval, run.rng.c_str(), run.bidirectional,
+		       run.msgsize, run.linkrate, run.dupack, run.cwndmode, run.timeout, run.delayedack, run.piggyback,
+		       run.a_application, run.a_transport, run.b_transport, run.b_application,
+		       run.total_time, run.throughput,
+		       run.latency_mean, run.latency_p50, run.latency_p99, run.latency_p999, run.latency_max,
+		       run.overhead, run.goodput, run.b_application_sent, run.a_application_recv, run.b_transport_sent,
+		       run.per_delivered, run.status);
+	}
+	fflush(stdout);
+	return;
+}
+
+/* worker thread: claim grid points until none are left */
+void sweep_worker()
+{
+	size_t i;
+	while ((i = nextRun.fetch_add(1)) < runs.size()) {
+		run_simulation(&runs[i]);
+		lock_guard<mutex> guard(outputLock);
+		runs[i].done = true;
+		print_finished_runs();
+	}
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	int workers = (int)thread::hardware_concurrency();
+
+	while ((opt = getopt(argc, argv, "s:w:m:l:c:t:r:b:z:k:D:W:T:A:P:j:")) != -1) {
+		switch (opt) {
+			case 's': seeds = parse_int_list(opt, optarg); break;
+			case 'w': windows = parse_int_list(opt, optarg); break;
+			case 'm': messageCounts = parse_int_list(opt, optarg); break;
+			case 'l': losses = parse_float_list(opt, optarg); break;
+			case 'c': corrupts = parse_float_list(opt, optarg); break;
+			case 't': intervals = parse_float_list(opt, optarg); break;
+			case 'r': rngs = split_list(optarg); break;
+			case 'b': directions = parse_int_list(opt, optarg); break;
+			case 'z': msgsizes = parse_int_list(opt, optarg); break;
+			case 'k': linkrates = parse_float_list(opt, optarg); break;
+			case 'D': dupacks = parse_int_list(opt, optarg); break;
+			case 'W': cwndmodes = parse_int_list(opt, optarg); break;
+			case 'T': timeouts = parse_float_list(opt, optarg); break;
+			case 'A': delayedacks = parse_int_list(opt, optarg); break;
+			case 'P': piggybacks = parse_int_list(opt, optarg); break;
+			case 'j': workers = atoi(optarg); break;
+			default: display_usage(argv[0]); return -1;
+		}
+	}
+	if (seeds.empty() || windows.empty() || messageCounts.empty() ||
+	    losses.empty() || corrupts.empty() || intervals.empty()) {
+		fprintf(stderr, "Missing arguments!\n");
+		display_usage(argv[0]);
+		return -1;
+	}
+	if (rngs.empty()) rngs.push_back("rand");
+	if (directions.empty()) directions.push_back(0);
+	if (msgsizes.empty()) msgsizes.push_back(MSGSIZE_DEFAULT);
+	if (linkrates.empty()) linkrates.push_back(0);
+	if (dupacks.empty()) dupacks.push_back(-1);
+	if (cwndmodes.empty()) cwndmodes.push_back(0);
+	if (timeouts.empty()) timeouts.push_back(0);
+	if (delayedacks.empty()) delayedacks.push_back(-1);
+	if (piggybacks.empty()) piggybacks.push_back(-1);
+	if (workers < 1) workers = 1;
+	// what the simulators reject, checked up front as no process exits on it now
+	for (size_t i = 0; i < losses.size(); i++) if (losses[i] > 1.0) return invalid_value('l');
+	for (size_t i = 0; i < corrupts.size(); i++) if (corrupts[i] > 1.0) return invalid_value('c');
+	for (size_t i = 0; i < intervals.size(); i++) if (intervals[i] <= 0.0) return invalid_value('t');
+	for (size_t i = 0; i < rngs.size(); i++) if (rng_kind(rngs[i].c_str()) < 0) return invalid_value('r');
+	for (size_t i = 0; i < timeouts.size(); i++) if (timeouts[i] < 0.0) return invalid_value('T');
+	for (size_t i = 0; i < msgsizes.size(); i++) if (msgsizes[i] < 1 || msgsizes[i] > PAYLOAD_MAX) return invalid_value('z');
+	for (size_t i = 0; i < delayedacks.size(); i++) if (delayedacks[i] == 0) return invalid_value('A');
+	for (size_t i = 0; i < piggybacks.size(); i++) if (piggybacks[i] > 1) return invalid_value('P');
+
+	// grid order: seed, then window, messages, loss, corruption, time, generator, direction,
+	// msg size, link rate, dup ACK threshold, cwnd mode, initial timeout, delayed ACK count,
+	// piggybacking
+	for (size_t s = 0; s < seeds.size(); s++)
+	for (size_t w = 0; w < windows.size(); w++)
+	for (size_t m = 0; m < messageCounts.size(); m++)
+	for (size_t l = 0; l < losses.size(); l++)
+	for (size_t c = 0; c < corrupts.size(); c++)
+	for (size_t t = 0; t < intervals.size(); t++)
+	for (size_t r = 0; r < rngs.size(); r++)
+	for (size_t b = 0; b < directions.size(); b++)
+	for (size_t z = 0; z < msgsizes.size(); z++)
+	for (size_t k = 0; k < linkrates.size(); k++)
+	for (size_t d = 0; d < dupacks.size(); d++)
+	for (size_t n = 0; n < cwndmodes.size(); n++)
+	for (size_t o = 0; o < timeouts.size(); o++)
+	for (size_t a = 0; a < delayedacks.size(); a++)
+	for (size_t p = 0; p < piggybacks.size(); p++) {
+		struct sweep_run run = sweep_run(); // report fields start at 0
+		run.seed = seeds[s];
+		run.window = windows[w];
+		run.messages = messageCounts[m];
+		run.loss = losses[l];
+		run.corrupt = corrupts[c];
+		run.interval = intervals[t];
+		run.rng = rngs[r];
+		run.bidirectional = directions[b] ? 1 : 0;
+		run.msgsize = msgsizes[z];
+		run.linkrate = linkrates[k];
+		run.dupack = dupacks[d];
+		run.cwndmode = cwndmodes[n] ? 1 : 0;
+		run.timeout = timeouts[o];
+		run.delayedack = delayedacks[a];
+		run.piggyback = piggybacks[p];
+		run.status = -1;
+		runs.push_back(run);
+	}
+
+	printf("protocol,seed,window,messages,loss,corrupt,time,rng,bidirectional,msgsize,linkrate,dupack,cwnd,timeout,delayedack,piggyback,a_application,a_transport,b_transport,b_application,total_time,throughput,latency_mean,latency_p50,latency_p99,latency_p999,latency_max,overhead,goodput,b_application_sent,a_application_recv,b_transport_sent,per_delivered,status\n");
+	vector<thread> pool;
+	for (int i = 0; i < workers && i < (int)runs.size(); i++) pool.push_back(thread(sweep_worker));
+	for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+
+	for (size_t i = 0; i < runs.size(); i++) {
+		if (runs[i].status != 0) return 1; // some simulation failed
+	}
+	return 0;
+}